@@ -29,15 +29,53 @@
 #endif /* _CRT_SECURE_NO_WARNINGS */
 #endif /* _MSC_VER */
 
+/* posix_madvise isn't declared under strict ISO C (-std=c99) without this */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #pragma CHECKED_SCOPE push
 #pragma CHECKED_SCOPE off
 
-#include <ctype.h> /* On Windows this needs a bounds safe interface or to be outside checked scope */
-#ifdef isspace
-#undef isspace /* Macro causes bounds issues on Linux/Mac systems */
+#include <stdint.h> /* Needed for SIZE_MAX */
+
+#if defined(_WIN32)
+#include <io.h>
+#define parson_write_fd(fd, data, len) _write((fd), (data), (unsigned int)(len))
+#else
+#include <unistd.h>
+#define parson_write_fd(fd, data, len) write((fd), (data), (len))
 #endif
 
-#include <stdint.h> /* Needed for SIZE_MAX */
+/* Define PARSON_NO_MMAP to read parsed files into memory instead of mapping them */
+#if !defined(PARSON_NO_MMAP) && !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+#define PARSON_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Define PARSON_NO_SIMD to build only the portable scanning code */
+#if !defined(PARSON_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define PARSON_SIMD_X86
+#include <immintrin.h>
+#elif !defined(PARSON_NO_SIMD) && defined(__GNUC__) && defined(__aarch64__)
+#define PARSON_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+/* Vectorized scanners use aligned loads, which may read past the end of the string but never
+   past its page. AddressSanitizer can't tell that apart from a real overflow. */
+#if defined(__SANITIZE_ADDRESS__)
+#define PARSON_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define PARSON_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+#endif
+#ifndef PARSON_NO_SANITIZE_ADDRESS
+#define PARSON_NO_SANITIZE_ADDRESS
+#endif
 
 #pragma CHECKED_SCOPE on
 
@@ -48,6 +86,7 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
+#include <float.h>
 
 
 /* Apparently sscanf is not implemented in some "standard" libraries, so don't use it, if you
@@ -55,14 +94,64 @@
 #define sscanf THINK_TWICE_ABOUT_USING_SSCANF
 
 #define STARTING_CAPACITY 16
-#define MAX_NESTING       1000
+#define MAX_NESTING       1000 /* default for json_set_max_nesting */
+
+#define OBJECT_INDEX_THRESHOLD 16 /* objects with fewer names are searched linearly */
+#define OBJECT_INLINE_CAPACITY 4  /* entries allocated with an empty object, parsed objects get exactly as many as they need */
+#define ARRAY_INLINE_CAPACITY  4  /* items allocated with an empty array, parsed arrays get exactly as many as they need */
+#define PARSED_INLINE_CAPACITY 16 /* parsed containers with more children keep them apart, so growing them frees the old ones */
+#define ARRAY_CELL_BOXED       0  /* type of a parsed cell pointing to a separate JSON_Value */
+#define OBJECT_NOT_FOUND       ((size_t)-1)
+
+#define ARENA_BLOCK_SIZE        4096 /* smallest arena block, first block is sized after the parsed string */
+#define ARENA_STARTING_CAPACITY 4    /* outgrown arena arrays aren't reused, so arena containers start smaller */
+#define ARENA_ALIGNMENT         8    /* enough for doubles and pointers */
+#define ARENA_ALIGN(size)       (((size) + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1))
+
+#define VALUE_FLAG_ARENA      1 /* value and its string, object or array are allocated from an arena */
+#define VALUE_FLAG_ARENA_ROOT 2 /* value is root of an arena, freeing it releases the whole arena */
+#define VALUE_FLAG_INT64      4 /* number is stored in value.integer */
+#define VALUE_FLAG_UINT64     8 /* number is stored in value.uinteger, only used above INT64_MAX */
+#define VALUE_FLAG_INTEGER    (VALUE_FLAG_INT64 | VALUE_FLAG_UINT64)
+#define VALUE_FLAG_SHORT_STRING 16 /* string is stored in value.short_string */
+#define VALUE_FLAG_PACKED     32 /* value was parsed into the values of its array and is freed with the array */
+
+#define SHORT_STRING_CAPACITY 8 /* bytes of a string stored in the value itself, including the terminator */
 
 #define FLOAT_FORMAT "%1.17g" /* do not increase precision without incresing NUM_BUF_SIZE */
 #define NUM_BUF_SIZE 64 /* double printed with "%1.17g" shouldn't be longer than 25 bytes so let's be paranoid and use 64 */
+#define SERIALIZATION_STARTING_CAPACITY 256
+#define SERIALIZATION_STREAM_BUFFER_SIZE 4096
+#define SERIALIZER_STARTING_DEPTH 16
+#define SERIALIZER_STRING_SLICE 1024 /* strings are escaped in slices, so huge strings aren't buffered whole */
+
+#define PARSER_STARTING_TOKEN_CAPACITY 64
+
+#define PARSER_STATE_VALUE        0 /* any value */
+#define PARSER_STATE_VALUE_OR_END 1 /* first value of an array or ']' */
+#define PARSER_STATE_NAME_OR_END  2 /* first name of an object or '}' */
+#define PARSER_STATE_NAME         3
+#define PARSER_STATE_COLON        4
+#define PARSER_STATE_COMMA_OR_END 5 /* ',' or end of the innermost container */
+#define PARSER_STATE_DONE         6 /* root value is complete, rest of the input is ignored */
+
+#define TAPE_STARTING_CAPACITY 64
+#define TAPE_NO_CONTAINER      ((size_t)-1)
+
+#define PARSER_TOKEN_NONE    0
+#define PARSER_TOKEN_STRING  1
+#define PARSER_TOKEN_NUMBER  2
+#define PARSER_TOKEN_LITERAL 3
+#define PARSER_TOKEN_COMMENT_START 4 /* '/' that starts a comment */
+#define PARSER_TOKEN_LINE_COMMENT  5
+#define PARSER_TOKEN_BLOCK_COMMENT 6
+#define PARSER_TOKEN_BLOCK_COMMENT_STAR 7 /* '*' that may end a block comment */
 
 #define SIZEOF_TOKEN(a)       (sizeof(a) - 1)
 #define SKIP_CHAR(str)        ((*str)++)
-#define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
+#define SKIP_WHITESPACES(str) (*(str) = skip_whitespaces(*(str)))
+#define IS_WHITESPACE(c)      ((c) == ' ' || (c) == '\n' || (c) == '\r' || (c) == '\t') /* only whitespace allowed by RFC 8259 */
+#define IS_NUMBER_CHAR(c)     (IS_DIGIT(c) || (c) == '-' || (c) == '+' || (c) == '.' || (c) == 'e' || (c) == 'E')
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
 
 #undef malloc
@@ -74,6 +163,16 @@
 #define IS_NUMBER_INVALID(x) (((x) * 0.0) != 0.0)
 #endif
 
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+#define MAX_MANTISSA_DIGITS        19 /* always fit in uint64_t */
+#define POWER_OF_FIVE_MIN_EXPONENT (-342)
+#define POWER_OF_FIVE_MAX_EXPONENT 308
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 parson_uint128_t;
+#endif
+
 _Itype_for_any(T) static _Ptr<void*(size_t s)> parson_malloc : itype(_Ptr<_Array_ptr<T> (size_t s) : byte_count(s)>);
 
 _Itype_for_any(T) static _Ptr<void(void*)> parson_free : itype(_Ptr<void (_Array_ptr<T> : byte_count(0))>);
@@ -82,6 +181,10 @@ _Itype_for_any(T) static _Ptr<void(void*)> parson_free : itype(_Ptr<void (_Array
 #define parson_free(t, p)   (free<t>(_Dynamic_bounds_cast<_Array_ptr<t>>(p, byte_count(0))))
 #define parson_free_unchecked(buf) (free(buf))
 
+/* Allocate from given arena or from the heap if it's NULL, arena memory is never freed separately */
+#define parson_arena_malloc(arena, t, sz) ((arena) != NULL ? json_arena_alloc<t>((arena), (sz)) : parson_malloc(t, sz))
+#define parson_arena_free(arena, t, p)    do { if ((arena) == NULL) { parson_free(t, p); } } while (0)
+
 static _Nt_array_ptr<char> parson_string_malloc(size_t sz) : count(sz) _Unchecked {
   if(sz >= SIZE_MAX)
     return NULL;
@@ -92,43 +195,190 @@ static _Nt_array_ptr<char> parson_string_malloc(size_t sz) : count(sz) _Unchecke
 }
 
 static int parson_escape_slashes = 1;
+static size_t parson_max_nesting = MAX_NESTING;
+
+#if defined(PARSON_SIMD_X86)
+#define CPU_FEATURE_AVX2 1
+
+static int parson_cpu_features = -1; /* detected on first use */
+#endif
 
 #define IS_CONT(b) (((unsigned char)(b) & 0xC0) == 0x80) /* is utf-8 continuation byte */
 
 /* Type definitions */
+typedef struct json_arena_t       JSON_Arena;
+typedef struct json_arena_block_t JSON_Arena_Block;
+
 typedef union json_value_value {
     char        *string : itype(_Nt_array_ptr<char>);
+    char         short_string _Nt_checked[SHORT_STRING_CAPACITY];
     double       number;
+    int64_t      integer;
+    uint64_t     uinteger;
     JSON_Object *object : itype(_Ptr<JSON_Object>);
     JSON_Array  *array  : itype(_Ptr<JSON_Array>);
     int          boolean;
     int          null;
+    JSON_Value  *boxed  : itype(_Ptr<JSON_Value>); /* only used by array cells */
 } JSON_Value_Value;
 
 struct json_value_t {
     JSON_Value      *parent : itype(_Ptr<JSON_Value>);
     JSON_Value_Type  type;
+    int              flags; /* VALUE_FLAG_* */
     JSON_Value_Value value;
 };
 
+/* Parsed value before it's stored. Nulls, booleans and numbers are kept in the cell itself
+   until their container closes, everything else is boxed. */
+typedef struct json_array_cell_t {
+    JSON_Value_Type  type;  /* type of the stored value, ARRAY_CELL_BOXED if it's in value.boxed */
+    int              flags; /* VALUE_FLAG_INTEGER bits of a stored number */
+    JSON_Value_Value value;
+} JSON_Array_Cell;
+
+typedef struct json_object_entry_t {
+    char       *name  : itype(_Nt_array_ptr<char>) count(length);
+    size_t      length;
+    uint32_t    hash;
+    JSON_Value *value : itype(_Ptr<JSON_Value>);
+} JSON_Object_Entry;
+
+typedef struct json_writer_t {
+    char  *buf : itype(_Array_ptr<char>) count(capacity); /* NULL if only size is computed */
+    size_t capacity;
+    size_t length;
+    int    growable; /* buf is owned by the writer and reallocated when full */
+    /* if set, buf is flushed with write_callback when full instead */
+    _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback;
+    void  *context : itype(_Ptr<void>);
+} JSON_Writer;
+
+typedef struct json_diy_fp_t { /* significand * 2^exponent, used for formatting doubles */
+    uint64_t significand;
+    int      exponent;
+} JSON_Diy_Fp;
+
 struct json_object_t {
-    JSON_Value  *wrapping_value : itype(_Ptr<JSON_Value>);
-    char       **names          : itype(_Array_ptr<_Nt_array_ptr<char>>) count(capacity);
-    JSON_Value **values         : itype(_Array_ptr<_Ptr<JSON_Value>>)    count(capacity);
-    size_t       count;
-    size_t       capacity;
+    JSON_Value        *wrapping_value : itype(_Ptr<JSON_Value>);
+    JSON_Object_Entry *entries        : itype(_Array_ptr<JSON_Object_Entry>) count(capacity);
+    size_t            *index          : itype(_Array_ptr<size_t>) count(index_capacity); /* entry index plus one, 0 marks an empty slot;
+                                                                                           NULL until count reaches OBJECT_INDEX_THRESHOLD */
+    size_t             count;
+    size_t             capacity;
+    size_t             index_capacity; /* power of two, at least twice the count */
+    JSON_Arena        *arena          : itype(_Ptr<JSON_Arena>); /* NULL if entries, index and names are on the heap */
+    size_t             inline_capacity; /* entries allocated right after the object, used while capacity doesn't exceed it */
 };
 
+/* Parsed arrays of nulls, booleans and numbers only are packed, they have no items until they're
+   changed and json_array_get_value returns their values directly. */
 struct json_array_t {
-    JSON_Value  *wrapping_value : itype(_Ptr<JSON_Value>);
-    JSON_Value **items          : itype(_Array_ptr<_Ptr<JSON_Value>>) count(capacity);
-    size_t       count;
-    size_t       capacity;
+    JSON_Value      *wrapping_value : itype(_Ptr<JSON_Value>);
+    JSON_Value     **items          : itype(_Array_ptr<_Ptr<JSON_Value>>) count(capacity);
+    size_t           count;
+    size_t           capacity;
+    JSON_Arena      *arena          : itype(_Ptr<JSON_Arena>); /* NULL if items are on the heap */
+    size_t           inline_capacity; /* items allocated right after the array, used while capacity doesn't exceed it */
+    size_t           values_count;    /* values allocated after the inline items, nulls, booleans and numbers
+                                         parsed into the array are stored there instead of on their own */
+};
+
+struct json_arena_block_t {
+    JSON_Arena_Block *next : itype(_Ptr<JSON_Arena_Block>);
+    size_t            size; /* bytes available after the aligned header */
+    size_t            used;
+};
+
+/* Memory of a document parsed by json_parse_string_arena. Values, strings and containers
+   are bump-allocated from blocks, which are all released when the root is freed. */
+struct json_arena_t {
+    JSON_Value        root;   /* has to be the first member, json_value_free gets arena from root */
+    JSON_Arena_Block *blocks : itype(_Ptr<JSON_Arena_Block>); /* most recent block first */
+    size_t            next_block_size;
+    int               dirty;  /* heap values were attached to the tree after parsing */
+    char             *buffer : itype(_Nt_array_ptr<char>); /* parsed string of an in-situ document, its strings and names point into it */
+};
+
+typedef struct json_serializer_frame_t {
+    const JSON_Value *value : itype(_Ptr<const JSON_Value>); /* array or object being serialized */
+    size_t            index;  /* number of started elements */
+} JSON_Serializer_Frame;
+
+/* State of incremental serialization. Every step appends a small piece of output to pending,
+   which is then copied out by json_serializer_next. */
+struct json_serializer_t {
+    JSON_Serializer_Frame *stack : itype(_Array_ptr<JSON_Serializer_Frame>) count(stack_capacity);
+    size_t                 stack_count;
+    size_t                 stack_capacity;
+    const JSON_Value      *next_value : itype(_Ptr<const JSON_Value>); /* value to start in the next step */
+    const char            *string : itype(_Nt_array_ptr<const char>) count(string_len); /* string being escaped */
+    size_t                 string_len;
+    size_t                 string_offset;
+    int                    string_is_key;
+    JSON_Writer            pending;
+    size_t                 pending_offset;
+    int                    is_pretty;
+    int                    failed;
+};
+
+typedef struct json_parse_entry_t {
+    char           *name : itype(_Nt_array_ptr<char>) count(length); /* NULL in arrays */
+    size_t          length;
+    JSON_Array_Cell cell; /* boxed, unless it's a scalar in an array that stores cells */
+} JSON_Parse_Entry;
+
+/* Scratch space of parse_value and the push parser. Values in containers that are still open are collected
+   in entries in document order, open containers included, and moved into their container when it closes. */
+typedef struct json_parse_scratch_t {
+    JSON_Parse_Entry  *entries : itype(_Array_ptr<JSON_Parse_Entry>) count(entries_capacity);
+    size_t             entries_count;
+    size_t             entries_capacity;
+    size_t            *open : itype(_Array_ptr<size_t>) count(open_capacity); /* entry index of every open container */
+    size_t             open_count;
+    size_t             open_capacity;
+} JSON_Parse_Scratch;
+
+/* State of a push parser. Values parsed so far are in scratch until their container closes,
+   complete root value is moved to root. */
+struct json_parser_t {
+    JSON_Parse_Scratch scratch;
+    JSON_Value  *root : itype(_Ptr<JSON_Value>);
+    char        *name : itype(_Nt_array_ptr<char>); /* parsed name waiting for its value */
+    JSON_Writer  token;      /* string, number or literal, which may be split between chunks */
+    int          token_type; /* PARSER_TOKEN_* */
+    int          state;      /* PARSER_STATE_* */
+    int          bom_matched; /* bytes of UTF-8 BOM matched at the start of input, -1 if there's none */
+    int          allow_comments;
+    int          failed;
+};
+
+typedef struct json_sax_state_t {
+    const JSON_Sax_Callbacks *callbacks : itype(_Ptr<const JSON_Sax_Callbacks>);
+    void                     *context : itype(_Ptr<void>);
+    char                     *buffer : itype(_Nt_array_ptr<char>) count(buffer_capacity); /* unescaped string, reused for every escaped string */
+    size_t                    buffer_capacity;
+    JSON_Writer               containers; /* closing characters of open arrays and objects */
+} JSON_Sax_State;
+
+typedef struct json_tape_entry_t {
+    size_t      offset; /* position of the value or name in the document's string */
+    size_t      next;   /* tape index after the value and everything in it */
+    JSON_Value *value : itype(_Ptr<JSON_Value>); /* decoded value, NULL until it's accessed */
+} JSON_Tape_Entry;
+
+/* Lazily parsed document. Tape records every value and name of the string in document order,
+   so containers can be skipped in one step while looking for a name. */
+struct json_document_t {
+    char            *string : itype(_Nt_array_ptr<char>);
+    JSON_Tape_Entry *tape : itype(_Array_ptr<JSON_Tape_Entry>) count(tape_capacity);
+    size_t           tape_count;
+    size_t           tape_capacity;
 };
 
 /* Various */
 static _Nt_array_ptr<char> read_file(_Nt_array_ptr<const char> filename);
-static void                remove_comments(_Nt_array_ptr<char> string, _Nt_array_ptr<const char> start_token, _Nt_array_ptr<const char> end_token);
+static JSON_Status _Unchecked parse_mapped_file(const char *filename : itype(_Nt_array_ptr<const char>), int allow_comments, JSON_Value **result : itype(_Ptr<_Ptr<JSON_Value>>));
 static _Nt_array_ptr<char> parson_strndup(_Nt_array_ptr<const char> string : count(n), size_t n);
 static _Nt_array_ptr<char> parson_strdup(_Nt_array_ptr<const char> string);
 static int                 hex_char_to_int(char c);
@@ -136,45 +386,145 @@ static int _Unchecked      parse_utf16_hex(const char* string, unsigned int* res
 static int                 num_bytes_in_utf8_sequence(unsigned char c);
 static int                 verify_utf8_sequence(_Nt_array_ptr<const unsigned char> string, _Ptr<int> len); // len is set after, not a constraint on string
 static int                 is_valid_utf8(_Nt_array_ptr<const char> string : bounds(string, string + string_len), size_t string_len);
-static int                 is_decimal(const char* string : itype(_Nt_array_ptr<const char>) count(length), size_t length);
+static uint32_t            hash_string(_Nt_array_ptr<const char> string : count(n), size_t n);
+
+/* Numbers */
+static uint64_t            multiply_u64(uint64_t a, uint64_t b, _Ptr<uint64_t> high);
+static int                 count_leading_zeros(uint64_t x);
+static int                 floor_log2_pow10(int exponent10);
+static int                 ceil_log10_pow2(int exponent2);
+static int                 eisel_lemire(uint64_t mantissa, int exponent10, int negative, _Ptr<double> result);
+static JSON_Status         parse_number(const char** string : itype(_Ptr<_Nt_array_ptr<const char>>), _Ptr<JSON_Value_Value> number, _Ptr<int> flags);
+static int                 format_integer(char *buf : itype(_Nt_array_ptr<char>), uint64_t magnitude, int negative);
+static JSON_Diy_Fp         diy_fp_multiply(JSON_Diy_Fp a, JSON_Diy_Fp b);
+static void                grisu_round(char *digits : itype(_Array_ptr<char>) count(length), int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance);
+static int                 grisu_generate_digits(JSON_Diy_Fp w, JSON_Diy_Fp upper, uint64_t delta, char *digits : itype(_Array_ptr<char>) count(18), _Ptr<int> exponent10);
+static int                 grisu2(double number, char *digits : itype(_Array_ptr<char>) count(18), _Ptr<int> exponent10);
+static int                 format_double(char *buf : itype(_Nt_array_ptr<char>), double number);
+
+/* Arena */
+static _Ptr<JSON_Arena>    json_arena_init(size_t first_block_size);
+_Itype_for_any(T) static void * json_arena_alloc(_Ptr<JSON_Arena> arena, size_t size) : itype(_Array_ptr<T>) byte_count(size);
+static _Nt_array_ptr<char> json_arena_string_malloc(_Ptr<JSON_Arena> arena, size_t sz) : count(sz);
+static _Nt_array_ptr<char> json_arena_strndup(_Ptr<JSON_Arena> arena, _Nt_array_ptr<const char> string : count(n), size_t n);
+static _Nt_array_ptr<char> json_arena_buffer_at(_Ptr<JSON_Arena> arena, _Nt_array_ptr<const char> string : count(len), size_t len) : count(len);
+static void                json_arena_attach(_Ptr<JSON_Arena> arena, _Ptr<const JSON_Value> value);
+static _Ptr<JSON_Value>    json_arena_set_root(_Ptr<JSON_Arena> arena, _Ptr<JSON_Value> value);
+static void                json_arena_free(_Ptr<JSON_Arena> arena);
 
 /* JSON Object */
-static _Ptr<JSON_Object> json_object_init(_Ptr<JSON_Value> wrapping_value);
+static _Ptr<JSON_Object> json_object_init(_Ptr<JSON_Value> wrapping_value, _Ptr<JSON_Arena> arena, size_t inline_capacity);
+static _Array_ptr<JSON_Object_Entry> json_object_inline_entries(_Ptr<JSON_Object> object) : count(object->inline_capacity);
 static JSON_Status       json_object_add(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name, _Ptr<JSON_Value> value);
 static JSON_Status       json_object_addn(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name : count(name_len), size_t name_len, _Ptr<JSON_Value> value);
+static JSON_Status       json_object_addn_no_copy(_Ptr<JSON_Object> object, _Nt_array_ptr<char> name : count(name_len), size_t name_len, _Ptr<JSON_Value> value);
 static JSON_Status       json_object_resize(_Ptr<JSON_Object> object, size_t new_capacity);
 static JSON_Value *      json_object_getn_value(_Ptr<const JSON_Object> object, _Nt_array_ptr<const char> name : count(name_len), size_t name_len) : itype(_Ptr<JSON_Value>);
+static size_t            json_object_find(_Ptr<const JSON_Object> object, _Nt_array_ptr<const char> name : count(name_len), size_t name_len);
+static JSON_Status       json_object_index_build(_Ptr<JSON_Object> object, size_t index_capacity);
+static void              json_object_index_insert(_Ptr<JSON_Object> object, size_t item);
+static size_t            json_object_index_slot(_Ptr<const JSON_Object> object, size_t item);
+static void              json_object_index_remove(_Ptr<JSON_Object> object, size_t item);
 static JSON_Status       json_object_remove_internal(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name, int free_value);
 static JSON_Status       json_object_dotremove_internal(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name, int free_value);
 static void              json_object_free(_Ptr<JSON_Object> object);
 
 /* JSON Array */
-static _Ptr<JSON_Array> json_array_init(_Ptr<JSON_Value> wrapping_value);
+static _Ptr<JSON_Array> json_array_init(_Ptr<JSON_Value> wrapping_value, _Ptr<JSON_Arena> arena, size_t inline_capacity, size_t values_count);
+static _Array_ptr<_Ptr<JSON_Value>> json_array_inline_items(_Ptr<JSON_Array> array) : count(array->inline_capacity);
+static _Array_ptr<JSON_Value> json_array_values(_Ptr<const JSON_Array> array) : count(array->values_count);
+static int              json_array_is_packed(_Ptr<const JSON_Array> array);
+static JSON_Status      json_array_unpack(_Ptr<JSON_Array> array);
 static JSON_Status      json_array_add(_Ptr<JSON_Array> array, _Ptr<JSON_Value> value);
+static JSON_Status      json_array_add_cell(_Ptr<JSON_Array> array, JSON_Array_Cell cell);
+static JSON_Status      json_array_box_cell(_Ptr<JSON_Array> array, _Ptr<JSON_Array_Cell> cell);
+static void             json_array_set_item(_Ptr<JSON_Array> array, size_t index, _Ptr<JSON_Value> value);
+static JSON_Status      json_array_replace_cell(_Ptr<JSON_Array> array, size_t index, JSON_Array_Cell cell);
 static JSON_Status      json_array_resize(_Ptr<JSON_Array> array, size_t new_capacity);
 static void             json_array_free(_Ptr<JSON_Array> array);
 
 /* JSON Value */
-static _Ptr<JSON_Value> json_value_init_string_no_copy(_Nt_array_ptr<char> string);
+static _Ptr<JSON_Value> json_value_alloc(_Ptr<JSON_Arena> arena, JSON_Value_Type type);
+static _Ptr<JSON_Value> json_value_init_object_internal(_Ptr<JSON_Arena> arena, size_t inline_capacity);
+static _Ptr<JSON_Value> json_value_init_array_internal(_Ptr<JSON_Arena> arena, size_t inline_capacity);
+static _Ptr<JSON_Value> json_value_init_string_no_copy(_Nt_array_ptr<char> string, _Ptr<JSON_Arena> arena);
+static _Ptr<JSON_Value> json_value_init_short_string(_Nt_array_ptr<const char> string : count(string_len), size_t string_len);
+static _Ptr<JSON_Value> json_value_init_cell(_Ptr<JSON_Arena> arena, _Ptr<const JSON_Array_Cell> cell);
+static void             json_value_free_arena(_Ptr<JSON_Value> value);
 
 /* Parser */
-static JSON_Status            skip_quotes(_Ptr<_Nt_array_ptr<const char>> string);
+#if defined(PARSON_SIMD_X86)
+static int                    cpu_features(void);
+#endif
+static _Nt_array_ptr<const char> skip_whitespaces(_Nt_array_ptr<const char> string);
+static const char * _Unchecked scan_string(const char *string, const char *end, char stop);
 static int _Unchecked         parse_utf16(const char** unprocessed : itype(_Ptr<_Nt_array_ptr<const char>>), char** processed : itype(_Ptr<_Nt_array_ptr<char>>));
-static _Nt_array_ptr<char>    process_string(_Nt_array_ptr<const char> input : count(len), size_t len);
-static _Nt_array_ptr<char>    get_quoted_string(_Ptr<_Nt_array_ptr<const char>> string);
-static _Ptr<JSON_Value>       parse_object_value(_Ptr<_Nt_array_ptr<const char>> string, size_t nesting);
-static _Ptr<JSON_Value>       parse_array_value(_Ptr<_Nt_array_ptr<const char>> string, size_t nesting);
-static _Ptr<JSON_Value>       parse_string_value(_Ptr<_Nt_array_ptr<const char>> string);
-static _Ptr<JSON_Value>       parse_boolean_value(_Ptr<_Nt_array_ptr<const char>> string);
-static _Ptr<JSON_Value>       parse_number_value(const char** string : itype(_Ptr<_Nt_array_ptr<const char>>));
-static _Ptr<JSON_Value>       parse_null_value(_Ptr<_Nt_array_ptr<const char>> string);
-static _Ptr<JSON_Value>       parse_value(_Ptr<_Nt_array_ptr<const char>> string, size_t nesting);
+static JSON_Status            unescape_string(_Nt_array_ptr<const char> input : count(input_len), size_t input_len, _Nt_array_ptr<char> output : count(output_len), size_t output_len);
+static JSON_Status _Unchecked scan_quoted_string(const char **string : itype(_Ptr<_Nt_array_ptr<const char>>), const char **start : itype(_Ptr<_Nt_array_ptr<const char>>),
+                                                 _Ptr<size_t> string_len, _Ptr<size_t> output_len, _Ptr<int> has_escapes);
+static _Nt_array_ptr<char>    get_quoted_string(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena, _Nt_array_ptr<char> short_buffer : count(SHORT_STRING_CAPACITY - 1));
+static JSON_Status            parse_scalar_cell(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena, _Ptr<JSON_Array_Cell> cell);
+static _Ptr<JSON_Value>       parse_string_value(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena);
+static JSON_Status            parse_boolean_cell(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Array_Cell> cell);
+static JSON_Status            parse_number_cell(const char** string : itype(_Ptr<_Nt_array_ptr<const char>>), _Ptr<JSON_Array_Cell> cell);
+static JSON_Status            parse_null_cell(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Array_Cell> cell);
+static JSON_Status            json_parse_scratch_add(_Ptr<JSON_Parse_Scratch> scratch, _Nt_array_ptr<char> name : count(name_len), size_t name_len, JSON_Array_Cell cell);
+static JSON_Status            json_parse_scratch_open(_Ptr<JSON_Parse_Scratch> scratch);
+static JSON_Status            json_parse_scratch_close(_Ptr<JSON_Parse_Scratch> scratch, _Ptr<JSON_Arena> arena);
+static void                   json_parse_cell_free(_Ptr<JSON_Array_Cell> cell, _Ptr<JSON_Arena> arena);
+static void                   json_parse_scratch_free(_Ptr<JSON_Parse_Scratch> scratch, _Ptr<JSON_Arena> arena);
+static _Ptr<JSON_Value>       parse_value(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena);
+
+/* Push parser */
+static JSON_Value_Type json_parser_container_type(_Ptr<JSON_Parser> parser);
+static JSON_Status json_parser_add_value(_Ptr<JSON_Parser> parser, _Ptr<JSON_Value> value);
+static JSON_Status json_parser_add_cell(_Ptr<JSON_Parser> parser, JSON_Array_Cell cell);
+static JSON_Status json_parser_close(_Ptr<JSON_Parser> parser, char c);
+static int         json_parser_string_is_complete(_Ptr<JSON_Parser> parser);
+static JSON_Status _Unchecked json_parser_add_token(_Ptr<JSON_Parser> parser, const char *token : itype(_Ptr<const char>), const char *token_end : itype(_Ptr<const char>));
+static JSON_Status _Unchecked json_parser_end_token(_Ptr<JSON_Parser> parser);
+static JSON_Status json_parser_scan(_Ptr<JSON_Parser> parser, const char *chunk : itype(_Array_ptr<const char>) count(len), size_t len);
+static _Ptr<JSON_Parser> json_parser_init_internal(int allow_comments);
+static void        json_parser_free(_Ptr<JSON_Parser> parser);
+static _Ptr<JSON_Value> json_parse_buffer_internal(_Array_ptr<const char> buf : count(len), size_t len, int allow_comments);
+
+/* Event parser */
+static JSON_Status _Unchecked sax_parse_string(const char **string : itype(_Ptr<_Nt_array_ptr<const char>>), _Ptr<JSON_Sax_State> state, int is_key);
+static JSON_Status sax_parse_scalar(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Sax_State> state);
+static JSON_Status sax_parse_value(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Sax_State> state);
+
+/* Lazy document */
+static JSON_Status json_tape_push(_Ptr<JSON_Document> document, size_t offset);
+static JSON_Status _Unchecked json_tape_skip_string(const char **string : itype(_Ptr<_Nt_array_ptr<const char>>));
+static JSON_Status json_tape_skip_literal(_Ptr<_Nt_array_ptr<const char>> string, _Nt_array_ptr<const char> literal);
+static JSON_Status json_tape_skip_scalar(_Ptr<_Nt_array_ptr<const char>> string);
+static JSON_Status json_tape_build_value(_Ptr<JSON_Document> document, _Ptr<_Nt_array_ptr<const char>> string);
+static int _Unchecked json_document_name_equals(_Ptr<const JSON_Document> document, size_t index, const char *name : itype(_Nt_array_ptr<const char>) count(name_len), size_t name_len);
+static size_t      json_document_find(_Ptr<const JSON_Document> document, size_t index, _Nt_array_ptr<const char> name : count(name_len), size_t name_len);
+static _Ptr<JSON_Value> json_document_decode(_Ptr<JSON_Document> document, size_t index);
 
 /* Serialization */
-static int            json_serialize_to_buffer_r(_Ptr<const JSON_Value> value, _Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len), int level, int is_pretty, _Nt_array_ptr<char> num_buf, _Nt_array_ptr<char> buf_start : byte_count(buf_len), size_t buf_len);
-static int            json_serialize_string(_Nt_array_ptr<const char> string, _Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len), _Nt_array_ptr<char> buf_start : byte_count(buf_len), size_t buf_len);
-static int _Unchecked append_indent(_Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len), int level, _Nt_array_ptr<char> buf_start : byte_count(buf_len), size_t buf_len);
-static int _Unchecked append_string(_Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len), _Nt_array_ptr<const char> string, _Nt_array_ptr<char> buf_start : byte_count(buf_len), size_t buf_len);
+static JSON_Status     writer_reserve(_Ptr<JSON_Writer> writer, size_t len);
+static JSON_Status     writer_append(_Ptr<JSON_Writer> writer, const char *string : itype(_Array_ptr<const char>) count(len), size_t len);
+static JSON_Status     writer_append_indent(_Ptr<JSON_Writer> writer, int level);
+static JSON_Status     writer_append_number(_Ptr<JSON_Writer> writer, _Ptr<const JSON_Value> value);
+static JSON_Status     writer_flush(_Ptr<JSON_Writer> writer);
+static JSON_Status     writer_finish(_Ptr<JSON_Writer> writer);
+static size_t          write_to_file(void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len);
+static size_t          write_to_fd(void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len);
+static JSON_Status     json_serialize_to_callback_internal(_Ptr<const JSON_Value> value, _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback, void *context : itype(_Ptr<void>), int is_pretty);
+static JSON_Status     json_serialize_to_file_internal(_Ptr<const JSON_Value> value, _Nt_array_ptr<const char> filename, int is_pretty);
+static JSON_Status     json_serialize_to_writer_r(_Ptr<const JSON_Value> value, _Ptr<JSON_Writer> writer, int level, int is_pretty);
+static JSON_Status     json_serialize_string(_Nt_array_ptr<const char> string : count(len), size_t len, _Ptr<JSON_Writer> writer);
+static JSON_Status     json_serialize_string_chars(_Array_ptr<const char> string : count(len), size_t len, _Ptr<JSON_Writer> writer);
+static _Ptr<JSON_Serializer> json_serializer_init_internal(_Ptr<const JSON_Value> value, int is_pretty);
+static JSON_Status     json_serializer_push(_Ptr<JSON_Serializer> serializer, _Ptr<const JSON_Value> value);
+static JSON_Status     json_serializer_start_string(_Ptr<JSON_Serializer> serializer, _Nt_array_ptr<const char> string : count(len), size_t len, int is_key);
+static JSON_Status     json_serializer_step(_Ptr<JSON_Serializer> serializer);
+static size_t          json_serialization_size_internal(_Ptr<const JSON_Value> value, int is_pretty);
+static JSON_Status     json_serialize_to_buffer_internal(_Ptr<const JSON_Value> value, _Nt_array_ptr<char> buf : byte_count(buf_size_in_bytes), size_t buf_size_in_bytes, int is_pretty);
+static _Nt_array_ptr<char> json_serialize_to_string_internal(_Ptr<const JSON_Value> value, int is_pretty);
+static JSON_Status     json_serialize_to_reusable_buffer_internal(_Ptr<const JSON_Value> value, _Ptr<_Nt_array_ptr<char>> buf, _Ptr<size_t> buf_size, int is_pretty);
 
 /* Various */
 static _Nt_array_ptr<char> parson_strndup(_Nt_array_ptr<const char> string : count(n), size_t n) {
@@ -297,20 +647,15 @@ static int is_valid_utf8(_Nt_array_ptr<const char> string : bounds(string, strin
     return 1;
 }
 
-static int is_decimal(const char* string : itype(_Nt_array_ptr<const char>) count(length), size_t length) {
-    if (length > 1 && string[0] == '0' && string[1] != '.') {
-        return 0;
-    }
-    // The following dynamic bounds cast should not be needed; length > 2 > 0
-    if (length > 2 && !strncmp(_Dynamic_bounds_cast<_Nt_array_ptr<const char>>(string, count(0)), "-0", 2) && string[2] != '.') {
-        return 0;
-    }
-    while (length--) {
-        if (strchr("xX", string[length])) {
-            return 0;
-        }
+/* 32-bit FNV-1a */
+static uint32_t hash_string(_Nt_array_ptr<const char> string : count(n), size_t n) {
+    uint32_t hash = 2166136261u;
+    size_t i;
+    for (i = 0; i < n; i++) {
+        hash ^= (unsigned char)string[i];
+        hash *= 16777619u;
     }
-    return 1;
+    return hash;
 }
 
 static _Nt_array_ptr<char> read_file(_Nt_array_ptr<const char> filename) {
@@ -347,62 +692,186 @@ static _Nt_array_ptr<char> read_file(_Nt_array_ptr<const char> filename) {
     return file_contents;
 }
 
-static void remove_comments(_Nt_array_ptr<char> string, _Nt_array_ptr<const char> start_token, _Nt_array_ptr<const char> end_token) {
-    int in_string = 0, escaped = 0;
-    size_t i;
-    char current_char;
-    size_t start_token_len = strlen(start_token);
-    size_t end_token_len = strlen(end_token);
-    if (start_token_len == 0 || end_token_len == 0) {
-        return;
+/* Parses a file straight from a read-only mapping, so it's never copied into memory. Returns
+   JSONFailure if the file can't be mapped (e.g. it's a pipe) and has to be read instead.
+   TODO: Mapping is bounded only by the file size, which the compiler can't follow. */
+static _Unchecked JSON_Status parse_mapped_file(const char *filename : itype(_Nt_array_ptr<const char>), int allow_comments, JSON_Value **result : itype(_Ptr<_Ptr<JSON_Value>>)) {
+#if defined(PARSON_MMAP)
+    struct stat file_stat;
+    size_t size = 0;
+    void *mapping = NULL;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return JSONFailure;
     }
-    while ((current_char = *string) != '\0') {
-        if (current_char == '\\' && !escaped) {
-            escaped = 1;
-            string++;
-            continue;
-        } else if (current_char == '\"' && !escaped) {
-            in_string = !in_string;
-        // TODO: Can't prove this
-        } else {
-            _Unchecked {
-                char* unchecked_string = (char*)string;
-                if (!in_string && strncmp(unchecked_string, start_token, start_token_len) == 0) {
-                    for(i = 0; i < start_token_len; i++) {
-                        unchecked_string[i] = ' ';
-                    }
-                    unchecked_string = unchecked_string + start_token_len;
-                    char* ptr_ = strstr(unchecked_string, end_token);
-                    if (!ptr_) {
-                        return;
-                    }
-                    for (i = 0; i < (ptr_ - unchecked_string) + end_token_len; i++) {
-                        unchecked_string[i] = ' ';
-                    }
-                    
-                    string = _Assume_bounds_cast<_Nt_array_ptr<char>>(ptr_ + end_token_len - 1, count(0));
-                }
-            } // end _Unchecked
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0 ||
+        (uintmax_t)file_stat.st_size > SIZE_MAX) {
+        close(fd);
+        return JSONFailure;
+    }
+    size = (size_t)file_stat.st_size;
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return JSONFailure;
+    }
+    posix_madvise(mapping, size, POSIX_MADV_SEQUENTIAL); /* only a hint, parsing works without it */
+    *result = json_parse_buffer_internal((const char*)mapping, size, allow_comments);
+    munmap(mapping, size);
+    return JSONSuccess;
+#else
+    (void)filename;
+    (void)allow_comments;
+    (void)result;
+    return JSONFailure;
+#endif
+}
+
+/* Arena */
+static _Ptr<JSON_Arena> json_arena_init(size_t first_block_size) {
+    _Ptr<JSON_Arena> arena = parson_malloc(JSON_Arena, sizeof(JSON_Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->blocks = NULL;
+    arena->next_block_size = MAX(first_block_size, ARENA_BLOCK_SIZE);
+    arena->dirty = 0;
+    arena->buffer = NULL;
+    return arena;
+}
+
+// TODO: Carving typed memory out of a byte buffer can't be expressed in checked code.
+_Itype_for_any(T) static void * json_arena_alloc(_Ptr<JSON_Arena> arena, size_t size) : itype(_Array_ptr<T>) byte_count(size) _Unchecked {
+    JSON_Arena_Block *block = arena->blocks;
+    size_t header_size = ARENA_ALIGN(sizeof(JSON_Arena_Block));
+    size_t aligned_size = 0;
+    size_t block_size = 0;
+    char *result = NULL;
+    if (size > SIZE_MAX / 2) {
+        return NULL;
+    }
+    aligned_size = ARENA_ALIGN(size);
+    if (block == NULL || block->size - block->used < aligned_size) {
+        block_size = MAX(arena->next_block_size, aligned_size);
+        if (block_size > SIZE_MAX - header_size) {
+            return NULL;
         }
-        escaped = 0;
-        string++;
+        block = (JSON_Arena_Block*)parson_malloc(char, header_size + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        block->size = block_size;
+        block->used = 0;
+        arena->blocks = block;
+        if (arena->next_block_size <= SIZE_MAX / 4) {
+            arena->next_block_size *= 2;
+        }
+    }
+    result = (char*)block + header_size + block->used;
+    block->used += aligned_size;
+    return result;
+}
+
+static _Nt_array_ptr<char> json_arena_string_malloc(_Ptr<JSON_Arena> arena, size_t sz) : count(sz) _Unchecked {
+  if(sz >= SIZE_MAX)
+    return NULL;
+  char *p = (char*)json_arena_alloc<char>(arena, sz + 1);
+  if (p != NULL)
+    p[sz] = 0;
+  return _Assume_bounds_cast<_Nt_array_ptr<char>>(p, count(sz));
+}
+
+static _Nt_array_ptr<char> json_arena_strndup(_Ptr<JSON_Arena> arena, _Nt_array_ptr<const char> string : count(n), size_t n) {
+    _Nt_array_ptr<char> output_string : count(n) = json_arena_string_malloc(arena, n);
+    if (!output_string) {
+        return NULL;
+    }
+    output_string[n] = '\0';
+    strncpy(output_string, string, n);
+    return output_string;
+}
+
+// TODO: The buffer is only read through const pointers while parsing, which can't be expressed in checked code.
+/* Returns writable part of in-situ document's buffer pointed to by string */
+static _Nt_array_ptr<char> json_arena_buffer_at(_Ptr<JSON_Arena> arena, _Nt_array_ptr<const char> string : count(len), size_t len) : count(len) _Unchecked {
+    char *buffer = arena->buffer;
+    return _Assume_bounds_cast<_Nt_array_ptr<char>>(buffer + ((const char*)string - buffer), count(len));
+}
+
+/* Marks arena as dirty if attached value has to be freed separately */
+static void json_arena_attach(_Ptr<JSON_Arena> arena, _Ptr<const JSON_Value> value) {
+    if (arena != NULL && (value->flags & (VALUE_FLAG_ARENA | VALUE_FLAG_ARENA_ROOT)) != VALUE_FLAG_ARENA) {
+        arena->dirty = 1;
+    }
+}
+
+/* Moves parsed root into the arena, so that freeing it releases the arena */
+static _Ptr<JSON_Value> json_arena_set_root(_Ptr<JSON_Arena> arena, _Ptr<JSON_Value> value) {
+    _Ptr<JSON_Value> root = &arena->root;
+    _Ptr<JSON_Object> object = NULL;
+    _Ptr<JSON_Array> array = NULL;
+    size_t i = 0;
+    *root = *value;
+    root->flags |= VALUE_FLAG_ARENA_ROOT;
+    switch (json_value_get_type(root)) {
+        case JSONObject:
+            object = root->value.object;
+            object->wrapping_value = root;
+            for (i = 0; i < object->count; i++) {
+                object->entries[i].value->parent = root;
+            }
+            break;
+        case JSONArray:
+            array = root->value.array;
+            array->wrapping_value = root;
+            for (i = 0; i < array->count; i++) {
+                json_array_get_value(array, i)->parent = root;
+            }
+            break;
+        default:
+            break;
+    }
+    return root;
+}
+
+static void json_arena_free(_Ptr<JSON_Arena> arena) {
+    _Ptr<JSON_Arena_Block> block = arena->blocks;
+    _Ptr<JSON_Arena_Block> next = NULL;
+    while (block != NULL) {
+        next = block->next;
+        parson_free(JSON_Arena_Block, block);
+        block = next;
     }
+    parson_free(char, arena->buffer);
+    parson_free(JSON_Arena, arena);
 }
 
 /* JSON Object */
-static _Ptr<JSON_Object> json_object_init(_Ptr<JSON_Value> wrapping_value) {
-    _Ptr<JSON_Object> new_obj = parson_malloc(JSON_Object, sizeof(JSON_Object));
+static _Ptr<JSON_Object> json_object_init(_Ptr<JSON_Value> wrapping_value, _Ptr<JSON_Arena> arena, size_t inline_capacity) {
+    _Ptr<JSON_Object> new_obj = parson_arena_malloc(arena, JSON_Object, sizeof(JSON_Object) + inline_capacity * sizeof(JSON_Object_Entry));
     if (new_obj == NULL) {
         return NULL;
     }
     new_obj->wrapping_value = wrapping_value;
-    new_obj->names = NULL;
-    new_obj->values = NULL;
-    new_obj->capacity = 0;
+    new_obj->inline_capacity = inline_capacity;
+    // TODO: The two statements below need to be changed atomically
+    new_obj->capacity = inline_capacity;
+    new_obj->entries = inline_capacity > 0 ? json_object_inline_entries(new_obj) : NULL;
+    new_obj->index = NULL;
     new_obj->count = 0;
+    new_obj->index_capacity = 0;
+    new_obj->arena = arena;
     return new_obj;
 }
 
+static _Array_ptr<JSON_Object_Entry> json_object_inline_entries(_Ptr<JSON_Object> object) : count(object->inline_capacity) {
+    // TODO: Inline entries are allocated together with the object, which can't be expressed in checked code.
+    _Unchecked {
+        return _Assume_bounds_cast<_Array_ptr<JSON_Object_Entry>>((JSON_Object_Entry*)((JSON_Object*)object + 1), count(object->inline_capacity));
+    }
+}
+
 static JSON_Status json_object_add(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name, _Ptr<JSON_Value> value) {
     if (name == NULL) {
         return JSONFailure;
@@ -417,6 +886,27 @@ static JSON_Status json_object_add(_Ptr<JSON_Object> object, _Nt_array_ptr<const
 }
 
 static JSON_Status json_object_addn(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name : count(name_len), size_t name_len, _Ptr<JSON_Value> value) {
+    _Nt_array_ptr<char> name_copy : count(name_len) = NULL;
+    if (object == NULL || name == NULL || value == NULL) {
+        return JSONFailure;
+    }
+    if (object->arena != NULL) {
+        name_copy = json_arena_strndup(object->arena, name, name_len);
+    } else {
+        name_copy = parson_strndup(name, name_len);
+    }
+    if (name_copy == NULL) {
+        return JSONFailure;
+    }
+    if (json_object_addn_no_copy(object, name_copy, name_len, value) == JSONFailure) {
+        parson_arena_free(object->arena, char, name_copy);
+        return JSONFailure;
+    }
+    return JSONSuccess;
+}
+
+/* Takes ownership of the name if it succeeds, the name has to be allocated the same way as the object's entries. */
+static JSON_Status json_object_addn_no_copy(_Ptr<JSON_Object> object, _Nt_array_ptr<char> name : count(name_len), size_t name_len, _Ptr<JSON_Value> value) {
     size_t index = 0;
     if (object == NULL || name == NULL || value == NULL) {
         return JSONFailure;
@@ -425,97 +915,199 @@ static JSON_Status json_object_addn(_Ptr<JSON_Object> object, _Nt_array_ptr<cons
         return JSONFailure;
     }
     if (object->count >= object->capacity) {
-        size_t new_capacity = MAX(object->capacity * 2, STARTING_CAPACITY);
+        size_t new_capacity = MAX(object->capacity * 2, object->arena != NULL ? ARENA_STARTING_CAPACITY : STARTING_CAPACITY);
         if (json_object_resize(object, new_capacity) == JSONFailure) {
             return JSONFailure;
         }
     }
-    index = object->count;
-    object->names[index] = parson_strndup(name, name_len);
-    if (object->names[index] == NULL) {
-        return JSONFailure;
+    if (object->count + 1 >= OBJECT_INDEX_THRESHOLD && (object->count + 1) * 2 > object->index_capacity) {
+        /* Failing to build the index only makes lookups slower, so it's not an error */
+        if (json_object_index_build(object, MAX(object->index_capacity * 2, OBJECT_INDEX_THRESHOLD * 2)) == JSONFailure) {
+            parson_arena_free(object->arena, size_t, object->index);
+            object->index = NULL;
+            object->index_capacity = 0;
+        }
     }
+    index = object->count;
+    // TODO: The two statements below need to be changed atomically
+    object->entries[index].length = name_len;
+    object->entries[index].name = name;
+    object->entries[index].hash = hash_string(name, name_len);
     value->parent = json_object_get_wrapping_value(object);
-    object->values[index] = value;
+    json_arena_attach(object->arena, value);
+    object->entries[index].value = value;
     object->count++;
+    if (object->index != NULL) {
+        json_object_index_insert(object, index);
+    }
     return JSONSuccess;
 }
 
 static JSON_Status json_object_resize(_Ptr<JSON_Object> object, size_t new_capacity) {
-    if ((object->names == NULL && object->values != NULL) ||
-        (object->names != NULL && object->values == NULL) ||
-        new_capacity == 0) {
-            return JSONFailure; /* Shouldn't happen */
+    _Array_ptr<JSON_Object_Entry> new_entries : count(new_capacity) = NULL;
+    if (new_capacity == 0 || new_capacity < object->count) {
+        return JSONFailure; /* Shouldn't happen */
     }
-
-    _Unchecked {
-        char** temp_names = (char**)parson_malloc(char*, new_capacity * sizeof(char*));
-        if (temp_names == NULL) {
-            return JSONFailure;
+    if (new_capacity <= object->inline_capacity) {
+        if (object->capacity <= object->inline_capacity) {
+            return JSONSuccess;
         }
-        JSON_Value** temp_values = (JSON_Value**)parson_malloc(JSON_Value*, new_capacity * sizeof(JSON_Value*));
-        if (temp_values == NULL) {
-            parson_free_unchecked(temp_names);
+        // TODO: The two statements below need to be changed atomically
+        new_capacity = object->inline_capacity;
+        new_entries = json_object_inline_entries(object);
+    } else {
+        new_entries = parson_arena_malloc(object->arena, JSON_Object_Entry, new_capacity * sizeof(JSON_Object_Entry));
+        if (new_entries == NULL) {
             return JSONFailure;
         }
+    }
+    // We know that the capacity is bigger than the count from the earlier if statement.
+    // TODO: The compiler can't do a >= comparison, so unneeded dynamic bounds cast.
+    if (object->count > 0) {
+        memcpy<JSON_Object_Entry>(_Dynamic_bounds_cast<_Array_ptr<JSON_Object_Entry>>(new_entries, count(object->count)),
+                                  _Dynamic_bounds_cast<_Array_ptr<JSON_Object_Entry>>(object->entries, count(object->count)),
+                                  object->count * sizeof(JSON_Object_Entry));
+    }
+    if (object->capacity > object->inline_capacity) {
+        parson_arena_free(object->arena, JSON_Object_Entry, object->entries);
+    }
 
-        /* TODO: Memcpy functions below warn "cannot prove argument meets declared 
-        * bounds" 1st arg truly won't prove unless new_capacity > object->count, 
-        * which isn't checked here! It isn't exactly determined in the caller either.
-        * This sort of means we can't prove the second arg either, since we
-        * can't really know that count <= capacity. (Even if we could,
-        * the compiler would have trouble with "<")
-        *  This reasoning applies to both memcpy functions below. */
-        if (object->names != NULL && object->values != NULL && object->count > 0) {
-            memcpy(temp_names, object->names, object->count * sizeof(char*));
-            memcpy(temp_values, object->values, object->count * sizeof(JSON_Value*));
-        }
-        parson_free(_Nt_array_ptr<char>, object->names);
-        parson_free(_Ptr<JSON_Value>, object->values);
-        // TODO: The three statements below need to be changed atomically
-        object->capacity = new_capacity;
-        object->names = temp_names;
-        object->values = temp_values;
-    } // end _Unchecked
-
+    // TODO: This should be atomic
+    object->capacity = new_capacity;
+    object->entries = new_entries;
     return JSONSuccess;
 }
 
 static JSON_Value* json_object_getn_value(_Ptr<const JSON_Object> object, _Nt_array_ptr<const char> name : count(name_len), size_t name_len) : itype(_Ptr<JSON_Value>) {
-    size_t i, name_length;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        name_length = strlen(object->names[i]);
-        if (name_length != name_len) {
+    size_t i = json_object_find(object, name, name_len);
+    if (i == OBJECT_NOT_FOUND) {
+        return NULL;
+    }
+    return object->entries[i].value;
+}
+
+/* Returns index of the name-value pair with given name or OBJECT_NOT_FOUND.
+   Names are compared only if their lengths and hashes match. */
+static size_t json_object_find(_Ptr<const JSON_Object> object, _Nt_array_ptr<const char> name : count(name_len), size_t name_len) {
+    size_t i, item, mask;
+    uint32_t hash;
+    if (object == NULL) {
+        return OBJECT_NOT_FOUND;
+    }
+    hash = hash_string(name, name_len);
+    if (object->index == NULL) {
+        for (i = 0; i < json_object_get_count(object); i++) {
+            if (object->entries[i].length != name_len || object->entries[i].hash != hash) {
+                continue;
+            }
+            if (strncmp(object->entries[i].name, _Dynamic_bounds_cast<_Nt_array_ptr<const char>>(name, count(0)), name_len) == 0) {
+                return i;
+            }
+        }
+        return OBJECT_NOT_FOUND;
+    }
+    mask = object->index_capacity - 1;
+    for (i = hash & mask; object->index[i] != 0; i = (i + 1) & mask) {
+        item = object->index[i] - 1;
+        if (object->entries[item].length != name_len || object->entries[item].hash != hash) {
             continue;
         }
-        if (strncmp(object->names[i], _Dynamic_bounds_cast<_Nt_array_ptr<const char>>(name, count(0)), name_len) == 0) {
-            return object->values[i];
+        if (strncmp(object->entries[item].name, _Dynamic_bounds_cast<_Nt_array_ptr<const char>>(name, count(0)), name_len) == 0) {
+            return item;
         }
     }
-    return NULL;
+    return OBJECT_NOT_FOUND;
+}
+
+/* (Re)builds the name index with given number of slots, which has to be a power of two */
+static JSON_Status json_object_index_build(_Ptr<JSON_Object> object, size_t index_capacity) {
+    size_t i;
+    _Array_ptr<size_t> new_index : count(index_capacity) = NULL;
+    new_index = parson_arena_malloc(object->arena, size_t, index_capacity * sizeof(size_t));
+    if (new_index == NULL) {
+        return JSONFailure;
+    }
+    for (i = 0; i < index_capacity; i++) {
+        new_index[i] = 0;
+    }
+    parson_arena_free(object->arena, size_t, object->index);
+    // TODO: The two statements below need to be changed atomically
+    object->index_capacity = index_capacity;
+    object->index = new_index;
+    for (i = 0; i < object->count; i++) {
+        json_object_index_insert(object, i);
+    }
+    return JSONSuccess;
+}
+
+static void json_object_index_insert(_Ptr<JSON_Object> object, size_t item) {
+    size_t mask = object->index_capacity - 1;
+    size_t i = object->entries[item].hash & mask;
+    while (object->index[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    object->index[i] = item + 1;
+}
+
+/* Returns slot pointing at given name-value pair, the pair has to be indexed */
+static size_t json_object_index_slot(_Ptr<const JSON_Object> object, size_t item) {
+    size_t mask = object->index_capacity - 1;
+    size_t i = object->entries[item].hash & mask;
+    while (object->index[i] != item + 1) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/* Removes slot of given name-value pair, shifting back following slots
+   so probe sequences stay unbroken without tombstones. */
+static void json_object_index_remove(_Ptr<JSON_Object> object, size_t item) {
+    size_t mask = object->index_capacity - 1;
+    size_t hole = json_object_index_slot(object, item);
+    size_t i = (hole + 1) & mask;
+    size_t home = 0;
+    while (object->index[i] != 0) {
+        home = object->entries[object->index[i] - 1].hash & mask;
+        /* slot i can fill the hole if the hole lies on its probe sequence (home..i) */
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            object->index[hole] = object->index[i];
+            hole = i;
+        }
+        i = (i + 1) & mask;
+    }
+    object->index[hole] = 0;
 }
 
 static JSON_Status json_object_remove_internal(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name, int free_value) {
     size_t i = 0, last_item_index = 0;
-    if (object == NULL || json_object_get_value(object, name) == NULL) {
+    if (object == NULL || name == NULL) {
+        return JSONFailure;
+    }
+    size_t name_len = strlen(name);
+    _Nt_array_ptr<const char> name_with_len : count(name_len) = NULL;
+    _Unchecked {
+        name_with_len = _Assume_bounds_cast<_Nt_array_ptr<const char>>(name, count(name_len));
+    }
+    i = json_object_find(object, name_with_len, name_len);
+    if (i == OBJECT_NOT_FOUND) {
         return JSONFailure;
     }
     last_item_index = json_object_get_count(object) - 1;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        if (strcmp(object->names[i], name) == 0) {
-            parson_free(char, object->names[i]);
-            if (free_value) {
-                json_value_free(object->values[i]);
-            }
-            if (i != last_item_index) { /* Replace key value pair with one from the end */
-                object->names[i] = object->names[last_item_index];
-                object->values[i] = object->values[last_item_index];
-            }
-            object->count -= 1;
-            return JSONSuccess;
+    if (object->index != NULL) {
+        json_object_index_remove(object, i);
+        if (i != last_item_index) {
+            object->index[json_object_index_slot(object, last_item_index)] = i + 1;
         }
     }
-    return JSONFailure; /* No execution path should end here */
+    parson_arena_free(object->arena, char, object->entries[i].name);
+    if (free_value) {
+        json_value_free(object->entries[i].value);
+    }
+    if (i != last_item_index) { /* Replace key value pair with one from the end */
+        object->entries[i] = object->entries[last_item_index];
+    }
+    object->count -= 1;
+    return JSONSuccess;
 }
 
 static JSON_Status json_object_dotremove_internal(_Ptr<JSON_Object> object, _Nt_array_ptr<const char> name, int free_value) {
@@ -544,57 +1136,173 @@ static JSON_Status json_object_dotremove_internal(_Ptr<JSON_Object> object, _Nt_
 static void json_object_free(_Ptr<JSON_Object> object) {
     size_t i;
     for (i = 0; i < object->count; i++) {
-        parson_free(char, object->names[i]);
-        json_value_free(object->values[i]);
+        parson_free(char, object->entries[i].name);
+        json_value_free(object->entries[i].value);
     }
-    parson_free(_Array_ptr<char>, object->names);
-    parson_free(_Array_ptr<JSON_Value>, object->values);
+    if (object->capacity > object->inline_capacity) {
+        parson_free(JSON_Object_Entry, object->entries);
+    }
+    parson_free(size_t, object->index);
     parson_free(JSON_Object, object);
 }
 
 /* JSON Array */
-static _Ptr<JSON_Array> json_array_init(_Ptr<JSON_Value> wrapping_value) {
-    _Ptr<JSON_Array> new_array = parson_malloc(JSON_Array, sizeof(JSON_Array));
+static _Ptr<JSON_Array> json_array_init(_Ptr<JSON_Value> wrapping_value, _Ptr<JSON_Arena> arena, size_t inline_capacity, size_t values_count) {
+    _Ptr<JSON_Array> new_array = parson_arena_malloc(arena, JSON_Array, sizeof(JSON_Array) + inline_capacity * sizeof(_Ptr<JSON_Value>) +
+                                                                        values_count * sizeof(JSON_Value));
     if (new_array == NULL) {
         return NULL;
     }
     new_array->wrapping_value = wrapping_value;
-    new_array->items = NULL;
-    new_array->capacity = 0;
+    new_array->inline_capacity = inline_capacity;
+    new_array->values_count = values_count;
+    // TODO: The two statements below need to be changed atomically
+    new_array->capacity = inline_capacity;
+    new_array->items = inline_capacity > 0 ? json_array_inline_items(new_array) : NULL;
     new_array->count = 0;
+    new_array->arena = arena;
     return new_array;
 }
 
+static _Array_ptr<_Ptr<JSON_Value>> json_array_inline_items(_Ptr<JSON_Array> array) : count(array->inline_capacity) {
+    // TODO: Inline items are allocated together with the array, which can't be expressed in checked code.
+    _Unchecked {
+        return _Assume_bounds_cast<_Array_ptr<_Ptr<JSON_Value>>>((JSON_Value**)((JSON_Array*)array + 1), count(array->inline_capacity));
+    }
+}
+
+static _Array_ptr<JSON_Value> json_array_values(_Ptr<const JSON_Array> array) : count(array->values_count) {
+    // TODO: Values are allocated together with the array, which can't be expressed in checked code.
+    _Unchecked {
+        return _Assume_bounds_cast<_Array_ptr<JSON_Value>>((JSON_Value*)((JSON_Value**)((JSON_Array*)array + 1) + array->inline_capacity),
+                                                           count(array->values_count));
+    }
+}
+
+static int json_array_is_packed(_Ptr<const JSON_Array> array) {
+    return array->items == NULL && array->values_count > 0;
+}
+
+/* Gives a packed array items pointing to its values, so that it can be changed like any other array.
+   Values stay where they are, so pointers returned by json_array_get_value remain valid. */
+static JSON_Status json_array_unpack(_Ptr<JSON_Array> array) {
+    size_t new_capacity = array->count;
+    _Array_ptr<_Ptr<JSON_Value>> new_items : count(new_capacity) = NULL;
+    _Array_ptr<JSON_Value> values : count(array->values_count) = NULL;
+    size_t i = 0;
+    if (!json_array_is_packed(array)) {
+        return JSONSuccess;
+    }
+    new_items = parson_arena_malloc(array->arena, _Ptr<JSON_Value>, new_capacity * sizeof(_Ptr<JSON_Value>));
+    if (new_items == NULL) {
+        return JSONFailure;
+    }
+    values = json_array_values(array);
+    for (i = 0; i < new_capacity; i++) {
+        new_items[i] = &values[i];
+    }
+    // TODO: The two statements below need to be changed atomically
+    array->capacity = new_capacity;
+    array->items = new_items;
+    return JSONSuccess;
+}
+
 static JSON_Status json_array_add(_Ptr<JSON_Array> array, _Ptr<JSON_Value> value) {
+    JSON_Array_Cell cell = { ARRAY_CELL_BOXED, 0, { NULL } };
+    cell.value.boxed = value;
+    return json_array_add_cell(array, cell);
+}
+
+static JSON_Status json_array_add_cell(_Ptr<JSON_Array> array, JSON_Array_Cell cell) {
+    if (json_array_unpack(array) == JSONFailure) {
+        return JSONFailure;
+    }
     if (array->count >= array->capacity) {
-        size_t new_capacity = MAX(array->capacity * 2, STARTING_CAPACITY);
+        size_t new_capacity = MAX(array->capacity * 2, array->arena != NULL ? ARENA_STARTING_CAPACITY : STARTING_CAPACITY);
         if (json_array_resize(array, new_capacity) == JSONFailure) {
             return JSONFailure;
         }
     }
-    value->parent = json_array_get_wrapping_value(array);
-    array->items[array->count] = value;
+    if (json_array_box_cell(array, &cell) == JSONFailure) {
+        return JSONFailure;
+    }
+    json_array_set_item(array, array->count, cell.value.boxed);
     array->count++;
     return JSONSuccess;
 }
 
+/* Gives a null, boolean or number its own JSON_Value */
+static JSON_Status json_array_box_cell(_Ptr<JSON_Array> array, _Ptr<JSON_Array_Cell> cell) {
+    _Ptr<JSON_Value> boxed = NULL;
+    if (cell->type == ARRAY_CELL_BOXED) {
+        return JSONSuccess;
+    }
+    boxed = json_value_init_cell(array->arena, cell);
+    if (boxed == NULL) {
+        return JSONFailure;
+    }
+    cell->type = ARRAY_CELL_BOXED;
+    cell->flags = 0;
+    cell->value.boxed = boxed;
+    return JSONSuccess;
+}
+
+/* Stores value without freeing the item it overwrites */
+static void json_array_set_item(_Ptr<JSON_Array> array, size_t index, _Ptr<JSON_Value> value) {
+    value->parent = json_array_get_wrapping_value(array);
+    json_arena_attach(array->arena, value);
+    array->items[index] = value;
+}
+
+/* Nulls, booleans and numbers overwrite values of packed arrays, anything else unpacks them */
+static JSON_Status json_array_replace_cell(_Ptr<JSON_Array> array, size_t index, JSON_Array_Cell cell) {
+    _Ptr<JSON_Value> value = NULL;
+    if (array == NULL || index >= json_array_get_count(array)) {
+        return JSONFailure;
+    }
+    if (json_array_is_packed(array) && cell.type != ARRAY_CELL_BOXED) {
+        value = json_array_get_value(array, index);
+        value->type = cell.type;
+        value->flags = (value->flags & ~VALUE_FLAG_INTEGER) | cell.flags;
+        value->value = cell.value;
+        return JSONSuccess;
+    }
+    if (json_array_unpack(array) == JSONFailure || json_array_box_cell(array, &cell) == JSONFailure) {
+        return JSONFailure;
+    }
+    json_value_free(array->items[index]);
+    json_array_set_item(array, index, cell.value.boxed);
+    return JSONSuccess;
+}
+
 static JSON_Status json_array_resize(_Ptr<JSON_Array> array, size_t new_capacity) {
     _Array_ptr<_Ptr<JSON_Value>> new_items : byte_count(new_capacity * sizeof(_Ptr<JSON_Value>)) = NULL;
     if (new_capacity == 0 || new_capacity < array-> count) {
         return JSONFailure;
     }
-    new_items = parson_malloc(_Ptr<JSON_Value>, new_capacity * sizeof(_Ptr<JSON_Value>));
-    if (new_items == NULL) {
-        return JSONFailure;
+    if (new_capacity <= array->inline_capacity) {
+        if (array->capacity <= array->inline_capacity) {
+            return JSONSuccess;
+        }
+        // TODO: The two statements below need to be changed atomically
+        new_capacity = array->inline_capacity;
+        new_items = json_array_inline_items(array);
+    } else {
+        new_items = parson_arena_malloc(array->arena, _Ptr<JSON_Value>, new_capacity * sizeof(_Ptr<JSON_Value>));
+        if (new_items == NULL) {
+            return JSONFailure;
+        }
     }
     // We know that the capacity is bigger than the count from the earlier if statement.
     // TODO: The compiler can't do a >= comparison, so unneeded dynamic bounds cast.
-    if (array->items != NULL && array->count > 0) {
-        memcpy<_Ptr<JSON_Value>>(_Dynamic_bounds_cast<_Array_ptr<_Ptr<JSON_Value>>>(new_items, byte_count(array->count * sizeof(_Ptr<JSON_Value>))), 
+    if (array->count > 0) {
+        memcpy<_Ptr<JSON_Value>>(_Dynamic_bounds_cast<_Array_ptr<_Ptr<JSON_Value>>>(new_items, byte_count(array->count * sizeof(_Ptr<JSON_Value>))),
                _Dynamic_bounds_cast<_Array_ptr<_Ptr<JSON_Value>>>(array->items, byte_count(array->count * sizeof(_Ptr<JSON_Value>))),
                array->count * sizeof(_Ptr<JSON_Value>));
     }
-    parson_free(_Ptr<JSON_Value>, array->items);
+    if (array->capacity > array->inline_capacity) {
+        parson_arena_free(array->arena, _Ptr<JSON_Value>, array->items);
+    }
 
     // TODO: This should be atomic
     array->capacity = new_capacity;
@@ -605,45 +1313,1423 @@ static JSON_Status json_array_resize(_Ptr<JSON_Array> array, size_t new_capacity
 static void json_array_free(_Ptr<JSON_Array> array) {
     size_t i;
     for (i = 0; i < array->count; i++) {
-        json_value_free(array->items[i]);
+        json_value_free(json_array_get_value(array, i));
+    }
+    if (array->capacity > array->inline_capacity) {
+        parson_free(_Ptr<JSON_Value>, array->items);
     }
-    parson_free(_Array_ptr<JSON_Value>, array->items);
     parson_free(JSON_Array, array);
 }
 
 /* JSON Value */
-static _Ptr<JSON_Value> json_value_init_string_no_copy(_Nt_array_ptr<char> string) {
-    _Ptr<JSON_Value> new_value = parson_malloc(JSON_Value, sizeof(JSON_Value));
+static _Ptr<JSON_Value> json_value_alloc(_Ptr<JSON_Arena> arena, JSON_Value_Type type) {
+    _Ptr<JSON_Value> new_value = parson_arena_malloc(arena, JSON_Value, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
-    new_value->type = JSONString;
-    new_value->value.string = string;
+    new_value->type = type;
+    new_value->flags = arena != NULL ? VALUE_FLAG_ARENA : 0;
     return new_value;
 }
 
-/* Parser */
-static JSON_Status skip_quotes(_Ptr<_Nt_array_ptr<const char>> string) {
-    if (**string != '\"') {
-        return JSONFailure;
+static _Ptr<JSON_Value> json_value_init_object_internal(_Ptr<JSON_Arena> arena, size_t inline_capacity) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(arena, JSONObject);
+    if (!new_value) {
+        return NULL;
     }
-    SKIP_CHAR(string);
-    while (**string != '\"') {
-        if (**string == '\0') {
-            return JSONFailure;
-        } else if (**string == '\\') {
-            SKIP_CHAR(string);
-            if (**string == '\0') {
-                return JSONFailure;
-            }
-        }
-        SKIP_CHAR(string);
+    new_value->value.object = json_object_init(new_value, arena, inline_capacity);
+    if (!new_value->value.object) {
+        parson_arena_free(arena, JSON_Value, new_value);
+        return NULL;
     }
-    SKIP_CHAR(string);
+    return new_value;
+}
+
+static _Ptr<JSON_Value> json_value_init_array_internal(_Ptr<JSON_Arena> arena, size_t inline_capacity) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(arena, JSONArray);
+    if (!new_value) {
+        return NULL;
+    }
+    new_value->value.array = json_array_init(new_value, arena, inline_capacity, 0);
+    if (!new_value->value.array) {
+        parson_arena_free(arena, JSON_Value, new_value);
+        return NULL;
+    }
+    return new_value;
+}
+
+static _Ptr<JSON_Value> json_value_init_string_no_copy(_Nt_array_ptr<char> string, _Ptr<JSON_Arena> arena) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(arena, JSONString);
+    if (!new_value) {
+        return NULL;
+    }
+    new_value->value.string = string;
+    return new_value;
+}
+
+/* Copies a string shorter than SHORT_STRING_CAPACITY into the value itself */
+static _Ptr<JSON_Value> json_value_init_short_string(_Nt_array_ptr<const char> string : count(string_len), size_t string_len) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(NULL, JSONString);
+    if (!new_value) {
+        return NULL;
+    }
+    memcpy<char>(_Dynamic_bounds_cast<_Nt_array_ptr<char>>(new_value->value.short_string, count(string_len)), string, string_len);
+    new_value->value.short_string[string_len] = '\0';
+    new_value->flags |= VALUE_FLAG_SHORT_STRING;
+    return new_value;
+}
+
+/* Boxes value stored in a parsed cell */
+static _Ptr<JSON_Value> json_value_init_cell(_Ptr<JSON_Arena> arena, _Ptr<const JSON_Array_Cell> cell) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(arena, cell->type);
+    if (!new_value) {
+        return NULL;
+    }
+    new_value->flags |= cell->flags;
+    new_value->value = cell->value;
+    return new_value;
+}
+
+/* Arena memory is released only together with the whole arena, so freeing other
+   arena values only frees heap values attached to them after parsing. */
+static void json_value_free_arena(_Ptr<JSON_Value> value) {
+    _Ptr<JSON_Object> object = NULL;
+    _Ptr<JSON_Array> array = NULL;
+    size_t i = 0;
+    switch (json_value_get_type(value)) {
+        case JSONObject:
+            object = value->value.object;
+            for (i = 0; object->arena->dirty && i < object->count; i++) {
+                json_value_free(object->entries[i].value);
+            }
+            break;
+        case JSONArray:
+            array = value->value.array;
+            for (i = 0; array->arena->dirty && i < array->count; i++) {
+                json_value_free(json_array_get_value(array, i));
+            }
+            break;
+        default:
+            break;
+    }
+    if (value->flags & VALUE_FLAG_ARENA_ROOT) {
+        // TODO: Root is the first member of the arena, which can't be expressed in checked code.
+        _Unchecked {
+            json_arena_free(_Assume_bounds_cast<_Ptr<JSON_Arena>>((JSON_Arena*)(JSON_Value*)value));
+        }
+    }
+}
+
+/* Numbers */
+
+/* Truncated 128-bit approximations of 5^q for q in [POWER_OF_FIVE_MIN_EXPONENT, POWER_OF_FIVE_MAX_EXPONENT],
+   normalized so the highest bit is set. Generated the same way as the table in fast_float
+   (https://github.com/fastfloat/fast_float), high 64 bits first. */
+static const uint64_t power_of_five_128 _Checked[2 * (POWER_OF_FIVE_MAX_EXPONENT - POWER_OF_FIVE_MIN_EXPONENT + 1)] = {
+    0xeef453d6923bd65au, 0x113faa2906a13b3fu,
+    0x9558b4661b6565f8u, 0x4ac7ca59a424c507u,
+    0xbaaee17fa23ebf76u, 0x5d79bcf00d2df649u,
+    0xe95a99df8ace6f53u, 0xf4d82c2c107973dcu,
+    0x91d8a02bb6c10594u, 0x79071b9b8a4be869u,
+    0xb64ec836a47146f9u, 0x9748e2826cdee284u,
+    0xe3e27a444d8d98b7u, 0xfd1b1b2308169b25u,
+    0x8e6d8c6ab0787f72u, 0xfe30f0f5e50e20f7u,
+    0xb208ef855c969f4fu, 0xbdbd2d335e51a935u,
+    0xde8b2b66b3bc4723u, 0xad2c788035e61382u,
+    0x8b16fb203055ac76u, 0x4c3bcb5021afcc31u,
+    0xaddcb9e83c6b1793u, 0xdf4abe242a1bbf3du,
+    0xd953e8624b85dd78u, 0xd71d6dad34a2af0du,
+    0x87d4713d6f33aa6bu, 0x8672648c40e5ad68u,
+    0xa9c98d8ccb009506u, 0x680efdaf511f18c2u,
+    0xd43bf0effdc0ba48u, 0x0212bd1b2566def2u,
+    0x84a57695fe98746du, 0x014bb630f7604b57u,
+    0xa5ced43b7e3e9188u, 0x419ea3bd35385e2du,
+    0xcf42894a5dce35eau, 0x52064cac828675b9u,
+    0x818995ce7aa0e1b2u, 0x7343efebd1940993u,
+    0xa1ebfb4219491a1fu, 0x1014ebe6c5f90bf8u,
+    0xca66fa129f9b60a6u, 0xd41a26e077774ef6u,
+    0xfd00b897478238d0u, 0x8920b098955522b4u,
+    0x9e20735e8cb16382u, 0x55b46e5f5d5535b0u,
+    0xc5a890362fddbc62u, 0xeb2189f734aa831du,
+    0xf712b443bbd52b7bu, 0xa5e9ec7501d523e4u,
+    0x9a6bb0aa55653b2du, 0x47b233c92125366eu,
+    0xc1069cd4eabe89f8u, 0x999ec0bb696e840au,
+    0xf148440a256e2c76u, 0xc00670ea43ca250du,
+    0x96cd2a865764dbcau, 0x380406926a5e5728u,
+    0xbc807527ed3e12bcu, 0xc605083704f5ecf2u,
+    0xeba09271e88d976bu, 0xf7864a44c633682eu,
+    0x93445b8731587ea3u, 0x7ab3ee6afbe0211du,
+    0xb8157268fdae9e4cu, 0x5960ea05bad82964u,
+    0xe61acf033d1a45dfu, 0x6fb92487298e33bdu,
+    0x8fd0c16206306babu, 0xa5d3b6d479f8e056u,
+    0xb3c4f1ba87bc8696u, 0x8f48a4899877186cu,
+    0xe0b62e2929aba83cu, 0x331acdabfe94de87u,
+    0x8c71dcd9ba0b4925u, 0x9ff0c08b7f1d0b14u,
+    0xaf8e5410288e1b6fu, 0x07ecf0ae5ee44dd9u,
+    0xdb71e91432b1a24au, 0xc9e82cd9f69d6150u,
+    0x892731ac9faf056eu, 0xbe311c083a225cd2u,
+    0xab70fe17c79ac6cau, 0x6dbd630a48aaf406u,
+    0xd64d3d9db981787du, 0x092cbbccdad5b108u,
+    0x85f0468293f0eb4eu, 0x25bbf56008c58ea5u,
+    0xa76c582338ed2621u, 0xaf2af2b80af6f24eu,
+    0xd1476e2c07286faau, 0x1af5af660db4aee1u,
+    0x82cca4db847945cau, 0x50d98d9fc890ed4du,
+    0xa37fce126597973cu, 0xe50ff107bab528a0u,
+    0xcc5fc196fefd7d0cu, 0x1e53ed49a96272c8u,
+    0xff77b1fcbebcdc4fu, 0x25e8e89c13bb0f7au,
+    0x9faacf3df73609b1u, 0x77b191618c54e9acu,
+    0xc795830d75038c1du, 0xd59df5b9ef6a2417u,
+    0xf97ae3d0d2446f25u, 0x4b0573286b44ad1du,
+    0x9becce62836ac577u, 0x4ee367f9430aec32u,
+    0xc2e801fb244576d5u, 0x229c41f793cda73fu,
+    0xf3a20279ed56d48au, 0x6b43527578c1110fu,
+    0x9845418c345644d6u, 0x830a13896b78aaa9u,
+    0xbe5691ef416bd60cu, 0x23cc986bc656d553u,
+    0xedec366b11c6cb8fu, 0x2cbfbe86b7ec8aa8u,
+    0x94b3a202eb1c3f39u, 0x7bf7d71432f3d6a9u,
+    0xb9e08a83a5e34f07u, 0xdaf5ccd93fb0cc53u,
+    0xe858ad248f5c22c9u, 0xd1b3400f8f9cff68u,
+    0x91376c36d99995beu, 0x23100809b9c21fa1u,
+    0xb58547448ffffb2du, 0xabd40a0c2832a78au,
+    0xe2e69915b3fff9f9u, 0x16c90c8f323f516cu,
+    0x8dd01fad907ffc3bu, 0xae3da7d97f6792e3u,
+    0xb1442798f49ffb4au, 0x99cd11cfdf41779cu,
+    0xdd95317f31c7fa1du, 0x40405643d711d583u,
+    0x8a7d3eef7f1cfc52u, 0x482835ea666b2572u,
+    0xad1c8eab5ee43b66u, 0xda3243650005eecfu,
+    0xd863b256369d4a40u, 0x90bed43e40076a82u,
+    0x873e4f75e2224e68u, 0x5a7744a6e804a291u,
+    0xa90de3535aaae202u, 0x711515d0a205cb36u,
+    0xd3515c2831559a83u, 0x0d5a5b44ca873e03u,
+    0x8412d9991ed58091u, 0xe858790afe9486c2u,
+    0xa5178fff668ae0b6u, 0x626e974dbe39a872u,
+    0xce5d73ff402d98e3u, 0xfb0a3d212dc8128fu,
+    0x80fa687f881c7f8eu, 0x7ce66634bc9d0b99u,
+    0xa139029f6a239f72u, 0x1c1fffc1ebc44e80u,
+    0xc987434744ac874eu, 0xa327ffb266b56220u,
+    0xfbe9141915d7a922u, 0x4bf1ff9f0062baa8u,
+    0x9d71ac8fada6c9b5u, 0x6f773fc3603db4a9u,
+    0xc4ce17b399107c22u, 0xcb550fb4384d21d3u,
+    0xf6019da07f549b2bu, 0x7e2a53a146606a48u,
+    0x99c102844f94e0fbu, 0x2eda7444cbfc426du,
+    0xc0314325637a1939u, 0xfa911155fefb5308u,
+    0xf03d93eebc589f88u, 0x793555ab7eba27cau,
+    0x96267c7535b763b5u, 0x4bc1558b2f3458deu,
+    0xbbb01b9283253ca2u, 0x9eb1aaedfb016f16u,
+    0xea9c227723ee8bcbu, 0x465e15a979c1cadcu,
+    0x92a1958a7675175fu, 0x0bfacd89ec191ec9u,
+    0xb749faed14125d36u, 0xcef980ec671f667bu,
+    0xe51c79a85916f484u, 0x82b7e12780e7401au,
+    0x8f31cc0937ae58d2u, 0xd1b2ecb8b0908810u,
+    0xb2fe3f0b8599ef07u, 0x861fa7e6dcb4aa15u,
+    0xdfbdcece67006ac9u, 0x67a791e093e1d49au,
+    0x8bd6a141006042bdu, 0xe0c8bb2c5c6d24e0u,
+    0xaecc49914078536du, 0x58fae9f773886e18u,
+    0xda7f5bf590966848u, 0xaf39a475506a899eu,
+    0x888f99797a5e012du, 0x6d8406c952429603u,
+    0xaab37fd7d8f58178u, 0xc8e5087ba6d33b83u,
+    0xd5605fcdcf32e1d6u, 0xfb1e4a9a90880a64u,
+    0x855c3be0a17fcd26u, 0x5cf2eea09a55067fu,
+    0xa6b34ad8c9dfc06fu, 0xf42faa48c0ea481eu,
+    0xd0601d8efc57b08bu, 0xf13b94daf124da26u,
+    0x823c12795db6ce57u, 0x76c53d08d6b70858u,
+    0xa2cb1717b52481edu, 0x54768c4b0c64ca6eu,
+    0xcb7ddcdda26da268u, 0xa9942f5dcf7dfd09u,
+    0xfe5d54150b090b02u, 0xd3f93b35435d7c4cu,
+    0x9efa548d26e5a6e1u, 0xc47bc5014a1a6dafu,
+    0xc6b8e9b0709f109au, 0x359ab6419ca1091bu,
+    0xf867241c8cc6d4c0u, 0xc30163d203c94b62u,
+    0x9b407691d7fc44f8u, 0x79e0de63425dcf1du,
+    0xc21094364dfb5636u, 0x985915fc12f542e4u,
+    0xf294b943e17a2bc4u, 0x3e6f5b7b17b2939du,
+    0x979cf3ca6cec5b5au, 0xa705992ceecf9c42u,
+    0xbd8430bd08277231u, 0x50c6ff782a838353u,
+    0xece53cec4a314ebdu, 0xa4f8bf5635246428u,
+    0x940f4613ae5ed136u, 0x871b7795e136be99u,
+    0xb913179899f68584u, 0x28e2557b59846e3fu,
+    0xe757dd7ec07426e5u, 0x331aeada2fe589cfu,
+    0x9096ea6f3848984fu, 0x3ff0d2c85def7621u,
+    0xb4bca50b065abe63u, 0x0fed077a756b53a9u,
+    0xe1ebce4dc7f16dfbu, 0xd3e8495912c62894u,
+    0x8d3360f09cf6e4bdu, 0x64712dd7abbbd95cu,
+    0xb080392cc4349decu, 0xbd8d794d96aacfb3u,
+    0xdca04777f541c567u, 0xecf0d7a0fc5583a0u,
+    0x89e42caaf9491b60u, 0xf41686c49db57244u,
+    0xac5d37d5b79b6239u, 0x311c2875c522ced5u,
+    0xd77485cb25823ac7u, 0x7d633293366b828bu,
+    0x86a8d39ef77164bcu, 0xae5dff9c02033197u,
+    0xa8530886b54dbdebu, 0xd9f57f830283fdfcu,
+    0xd267caa862a12d66u, 0xd072df63c324fd7bu,
+    0x8380dea93da4bc60u, 0x4247cb9e59f71e6du,
+    0xa46116538d0deb78u, 0x52d9be85f074e608u,
+    0xcd795be870516656u, 0x67902e276c921f8bu,
+    0x806bd9714632dff6u, 0x00ba1cd8a3db53b6u,
+    0xa086cfcd97bf97f3u, 0x80e8a40eccd228a4u,
+    0xc8a883c0fdaf7df0u, 0x6122cd128006b2cdu,
+    0xfad2a4b13d1b5d6cu, 0x796b805720085f81u,
+    0x9cc3a6eec6311a63u, 0xcbe3303674053bb0u,
+    0xc3f490aa77bd60fcu, 0xbedbfc4411068a9cu,
+    0xf4f1b4d515acb93bu, 0xee92fb5515482d44u,
+    0x991711052d8bf3c5u, 0x751bdd152d4d1c4au,
+    0xbf5cd54678eef0b6u, 0xd262d45a78a0635du,
+    0xef340a98172aace4u, 0x86fb897116c87c34u,
+    0x9580869f0e7aac0eu, 0xd45d35e6ae3d4da0u,
+    0xbae0a846d2195712u, 0x8974836059cca109u,
+    0xe998d258869facd7u, 0x2bd1a438703fc94bu,
+    0x91ff83775423cc06u, 0x7b6306a34627ddcfu,
+    0xb67f6455292cbf08u, 0x1a3bc84c17b1d542u,
+    0xe41f3d6a7377eecau, 0x20caba5f1d9e4a93u,
+    0x8e938662882af53eu, 0x547eb47b7282ee9cu,
+    0xb23867fb2a35b28du, 0xe99e619a4f23aa43u,
+    0xdec681f9f4c31f31u, 0x6405fa00e2ec94d4u,
+    0x8b3c113c38f9f37eu, 0xde83bc408dd3dd04u,
+    0xae0b158b4738705eu, 0x9624ab50b148d445u,
+    0xd98ddaee19068c76u, 0x3badd624dd9b0957u,
+    0x87f8a8d4cfa417c9u, 0xe54ca5d70a80e5d6u,
+    0xa9f6d30a038d1dbcu, 0x5e9fcf4ccd211f4cu,
+    0xd47487cc8470652bu, 0x7647c3200069671fu,
+    0x84c8d4dfd2c63f3bu, 0x29ecd9f40041e073u,
+    0xa5fb0a17c777cf09u, 0xf468107100525890u,
+    0xcf79cc9db955c2ccu, 0x7182148d4066eeb4u,
+    0x81ac1fe293d599bfu, 0xc6f14cd848405530u,
+    0xa21727db38cb002fu, 0xb8ada00e5a506a7cu,
+    0xca9cf1d206fdc03bu, 0xa6d90811f0e4851cu,
+    0xfd442e4688bd304au, 0x908f4a166d1da663u,
+    0x9e4a9cec15763e2eu, 0x9a598e4e043287feu,
+    0xc5dd44271ad3cdbau, 0x40eff1e1853f29fdu,
+    0xf7549530e188c128u, 0xd12bee59e68ef47cu,
+    0x9a94dd3e8cf578b9u, 0x82bb74f8301958ceu,
+    0xc13a148e3032d6e7u, 0xe36a52363c1faf01u,
+    0xf18899b1bc3f8ca1u, 0xdc44e6c3cb279ac1u,
+    0x96f5600f15a7b7e5u, 0x29ab103a5ef8c0b9u,
+    0xbcb2b812db11a5deu, 0x7415d448f6b6f0e7u,
+    0xebdf661791d60f56u, 0x111b495b3464ad21u,
+    0x936b9fcebb25c995u, 0xcab10dd900beec34u,
+    0xb84687c269ef3bfbu, 0x3d5d514f40eea742u,
+    0xe65829b3046b0afau, 0x0cb4a5a3112a5112u,
+    0x8ff71a0fe2c2e6dcu, 0x47f0e785eaba72abu,
+    0xb3f4e093db73a093u, 0x59ed216765690f56u,
+    0xe0f218b8d25088b8u, 0x306869c13ec3532cu,
+    0x8c974f7383725573u, 0x1e414218c73a13fbu,
+    0xafbd2350644eeacfu, 0xe5d1929ef90898fau,
+    0xdbac6c247d62a583u, 0xdf45f746b74abf39u,
+    0x894bc396ce5da772u, 0x6b8bba8c328eb783u,
+    0xab9eb47c81f5114fu, 0x066ea92f3f326564u,
+    0xd686619ba27255a2u, 0xc80a537b0efefebdu,
+    0x8613fd0145877585u, 0xbd06742ce95f5f36u,
+    0xa798fc4196e952e7u, 0x2c48113823b73704u,
+    0xd17f3b51fca3a7a0u, 0xf75a15862ca504c5u,
+    0x82ef85133de648c4u, 0x9a984d73dbe722fbu,
+    0xa3ab66580d5fdaf5u, 0xc13e60d0d2e0ebbau,
+    0xcc963fee10b7d1b3u, 0x318df905079926a8u,
+    0xffbbcfe994e5c61fu, 0xfdf17746497f7052u,
+    0x9fd561f1fd0f9bd3u, 0xfeb6ea8bedefa633u,
+    0xc7caba6e7c5382c8u, 0xfe64a52ee96b8fc0u,
+    0xf9bd690a1b68637bu, 0x3dfdce7aa3c673b0u,
+    0x9c1661a651213e2du, 0x06bea10ca65c084eu,
+    0xc31bfa0fe5698db8u, 0x486e494fcff30a62u,
+    0xf3e2f893dec3f126u, 0x5a89dba3c3efccfau,
+    0x986ddb5c6b3a76b7u, 0xf89629465a75e01cu,
+    0xbe89523386091465u, 0xf6bbb397f1135823u,
+    0xee2ba6c0678b597fu, 0x746aa07ded582e2cu,
+    0x94db483840b717efu, 0xa8c2a44eb4571cdcu,
+    0xba121a4650e4ddebu, 0x92f34d62616ce413u,
+    0xe896a0d7e51e1566u, 0x77b020baf9c81d17u,
+    0x915e2486ef32cd60u, 0x0ace1474dc1d122eu,
+    0xb5b5ada8aaff80b8u, 0x0d819992132456bau,
+    0xe3231912d5bf60e6u, 0x10e1fff697ed6c69u,
+    0x8df5efabc5979c8fu, 0xca8d3ffa1ef463c1u,
+    0xb1736b96b6fd83b3u, 0xbd308ff8a6b17cb2u,
+    0xddd0467c64bce4a0u, 0xac7cb3f6d05ddbdeu,
+    0x8aa22c0dbef60ee4u, 0x6bcdf07a423aa96bu,
+    0xad4ab7112eb3929du, 0x86c16c98d2c953c6u,
+    0xd89d64d57a607744u, 0xe871c7bf077ba8b7u,
+    0x87625f056c7c4a8bu, 0x11471cd764ad4972u,
+    0xa93af6c6c79b5d2du, 0xd598e40d3dd89bcfu,
+    0xd389b47879823479u, 0x4aff1d108d4ec2c3u,
+    0x843610cb4bf160cbu, 0xcedf722a585139bau,
+    0xa54394fe1eedb8feu, 0xc2974eb4ee658828u,
+    0xce947a3da6a9273eu, 0x733d226229feea32u,
+    0x811ccc668829b887u, 0x0806357d5a3f525fu,
+    0xa163ff802a3426a8u, 0xca07c2dcb0cf26f7u,
+    0xc9bcff6034c13052u, 0xfc89b393dd02f0b5u,
+    0xfc2c3f3841f17c67u, 0xbbac2078d443ace2u,
+    0x9d9ba7832936edc0u, 0xd54b944b84aa4c0du,
+    0xc5029163f384a931u, 0x0a9e795e65d4df11u,
+    0xf64335bcf065d37du, 0x4d4617b5ff4a16d5u,
+    0x99ea0196163fa42eu, 0x504bced1bf8e4e45u,
+    0xc06481fb9bcf8d39u, 0xe45ec2862f71e1d6u,
+    0xf07da27a82c37088u, 0x5d767327bb4e5a4cu,
+    0x964e858c91ba2655u, 0x3a6a07f8d510f86fu,
+    0xbbe226efb628afeau, 0x890489f70a55368bu,
+    0xeadab0aba3b2dbe5u, 0x2b45ac74ccea842eu,
+    0x92c8ae6b464fc96fu, 0x3b0b8bc90012929du,
+    0xb77ada0617e3bbcbu, 0x09ce6ebb40173744u,
+    0xe55990879ddcaabdu, 0xcc420a6a101d0515u,
+    0x8f57fa54c2a9eab6u, 0x9fa946824a12232du,
+    0xb32df8e9f3546564u, 0x47939822dc96abf9u,
+    0xdff9772470297ebdu, 0x59787e2b93bc56f7u,
+    0x8bfbea76c619ef36u, 0x57eb4edb3c55b65au,
+    0xaefae51477a06b03u, 0xede622920b6b23f1u,
+    0xdab99e59958885c4u, 0xe95fab368e45ecedu,
+    0x88b402f7fd75539bu, 0x11dbcb0218ebb414u,
+    0xaae103b5fcd2a881u, 0xd652bdc29f26a119u,
+    0xd59944a37c0752a2u, 0x4be76d3346f0495fu,
+    0x857fcae62d8493a5u, 0x6f70a4400c562ddbu,
+    0xa6dfbd9fb8e5b88eu, 0xcb4ccd500f6bb952u,
+    0xd097ad07a71f26b2u, 0x7e2000a41346a7a7u,
+    0x825ecc24c873782fu, 0x8ed400668c0c28c8u,
+    0xa2f67f2dfa90563bu, 0x728900802f0f32fau,
+    0xcbb41ef979346bcau, 0x4f2b40a03ad2ffb9u,
+    0xfea126b7d78186bcu, 0xe2f610c84987bfa8u,
+    0x9f24b832e6b0f436u, 0x0dd9ca7d2df4d7c9u,
+    0xc6ede63fa05d3143u, 0x91503d1c79720dbbu,
+    0xf8a95fcf88747d94u, 0x75a44c6397ce912au,
+    0x9b69dbe1b548ce7cu, 0xc986afbe3ee11abau,
+    0xc24452da229b021bu, 0xfbe85badce996168u,
+    0xf2d56790ab41c2a2u, 0xfae27299423fb9c3u,
+    0x97c560ba6b0919a5u, 0xdccd879fc967d41au,
+    0xbdb6b8e905cb600fu, 0x5400e987bbc1c920u,
+    0xed246723473e3813u, 0x290123e9aab23b68u,
+    0x9436c0760c86e30bu, 0xf9a0b6720aaf6521u,
+    0xb94470938fa89bceu, 0xf808e40e8d5b3e69u,
+    0xe7958cb87392c2c2u, 0xb60b1d1230b20e04u,
+    0x90bd77f3483bb9b9u, 0xb1c6f22b5e6f48c2u,
+    0xb4ecd5f01a4aa828u, 0x1e38aeb6360b1af3u,
+    0xe2280b6c20dd5232u, 0x25c6da63c38de1b0u,
+    0x8d590723948a535fu, 0x579c487e5a38ad0eu,
+    0xb0af48ec79ace837u, 0x2d835a9df0c6d851u,
+    0xdcdb1b2798182244u, 0xf8e431456cf88e65u,
+    0x8a08f0f8bf0f156bu, 0x1b8e9ecb641b58ffu,
+    0xac8b2d36eed2dac5u, 0xe272467e3d222f3fu,
+    0xd7adf884aa879177u, 0x5b0ed81dcc6abb0fu,
+    0x86ccbb52ea94baeau, 0x98e947129fc2b4e9u,
+    0xa87fea27a539e9a5u, 0x3f2398d747b36224u,
+    0xd29fe4b18e88640eu, 0x8eec7f0d19a03aadu,
+    0x83a3eeeef9153e89u, 0x1953cf68300424acu,
+    0xa48ceaaab75a8e2bu, 0x5fa8c3423c052dd7u,
+    0xcdb02555653131b6u, 0x3792f412cb06794du,
+    0x808e17555f3ebf11u, 0xe2bbd88bbee40bd0u,
+    0xa0b19d2ab70e6ed6u, 0x5b6aceaeae9d0ec4u,
+    0xc8de047564d20a8bu, 0xf245825a5a445275u,
+    0xfb158592be068d2eu, 0xeed6e2f0f0d56712u,
+    0x9ced737bb6c4183du, 0x55464dd69685606bu,
+    0xc428d05aa4751e4cu, 0xaa97e14c3c26b886u,
+    0xf53304714d9265dfu, 0xd53dd99f4b3066a8u,
+    0x993fe2c6d07b7fabu, 0xe546a8038efe4029u,
+    0xbf8fdb78849a5f96u, 0xde98520472bdd033u,
+    0xef73d256a5c0f77cu, 0x963e66858f6d4440u,
+    0x95a8637627989aadu, 0xdde7001379a44aa8u,
+    0xbb127c53b17ec159u, 0x5560c018580d5d52u,
+    0xe9d71b689dde71afu, 0xaab8f01e6e10b4a6u,
+    0x9226712162ab070du, 0xcab3961304ca70e8u,
+    0xb6b00d69bb55c8d1u, 0x3d607b97c5fd0d22u,
+    0xe45c10c42a2b3b05u, 0x8cb89a7db77c506au,
+    0x8eb98a7a9a5b04e3u, 0x77f3608e92adb242u,
+    0xb267ed1940f1c61cu, 0x55f038b237591ed3u,
+    0xdf01e85f912e37a3u, 0x6b6c46dec52f6688u,
+    0x8b61313bbabce2c6u, 0x2323ac4b3b3da015u,
+    0xae397d8aa96c1b77u, 0xabec975e0a0d081au,
+    0xd9c7dced53c72255u, 0x96e7bd358c904a21u,
+    0x881cea14545c7575u, 0x7e50d64177da2e54u,
+    0xaa242499697392d2u, 0xdde50bd1d5d0b9e9u,
+    0xd4ad2dbfc3d07787u, 0x955e4ec64b44e864u,
+    0x84ec3c97da624ab4u, 0xbd5af13bef0b113eu,
+    0xa6274bbdd0fadd61u, 0xecb1ad8aeacdd58eu,
+    0xcfb11ead453994bau, 0x67de18eda5814af2u,
+    0x81ceb32c4b43fcf4u, 0x80eacf948770ced7u,
+    0xa2425ff75e14fc31u, 0xa1258379a94d028du,
+    0xcad2f7f5359a3b3eu, 0x096ee45813a04330u,
+    0xfd87b5f28300ca0du, 0x8bca9d6e188853fcu,
+    0x9e74d1b791e07e48u, 0x775ea264cf55347eu,
+    0xc612062576589ddau, 0x95364afe032a819eu,
+    0xf79687aed3eec551u, 0x3a83ddbd83f52205u,
+    0x9abe14cd44753b52u, 0xc4926a9672793543u,
+    0xc16d9a0095928a27u, 0x75b7053c0f178294u,
+    0xf1c90080baf72cb1u, 0x5324c68b12dd6339u,
+    0x971da05074da7beeu, 0xd3f6fc16ebca5e04u,
+    0xbce5086492111aeau, 0x88f4bb1ca6bcf585u,
+    0xec1e4a7db69561a5u, 0x2b31e9e3d06c32e6u,
+    0x9392ee8e921d5d07u, 0x3aff322e62439fd0u,
+    0xb877aa3236a4b449u, 0x09befeb9fad487c3u,
+    0xe69594bec44de15bu, 0x4c2ebe687989a9b4u,
+    0x901d7cf73ab0acd9u, 0x0f9d37014bf60a11u,
+    0xb424dc35095cd80fu, 0x538484c19ef38c95u,
+    0xe12e13424bb40e13u, 0x2865a5f206b06fbau,
+    0x8cbccc096f5088cbu, 0xf93f87b7442e45d4u,
+    0xafebff0bcb24aafeu, 0xf78f69a51539d749u,
+    0xdbe6fecebdedd5beu, 0xb573440e5a884d1cu,
+    0x89705f4136b4a597u, 0x31680a88f8953031u,
+    0xabcc77118461cefcu, 0xfdc20d2b36ba7c3eu,
+    0xd6bf94d5e57a42bcu, 0x3d32907604691b4du,
+    0x8637bd05af6c69b5u, 0xa63f9a49c2c1b110u,
+    0xa7c5ac471b478423u, 0x0fcf80dc33721d54u,
+    0xd1b71758e219652bu, 0xd3c36113404ea4a9u,
+    0x83126e978d4fdf3bu, 0x645a1cac083126eau,
+    0xa3d70a3d70a3d70au, 0x3d70a3d70a3d70a4u,
+    0xccccccccccccccccu, 0xcccccccccccccccdu,
+    0x8000000000000000u, 0x0000000000000000u,
+    0xa000000000000000u, 0x0000000000000000u,
+    0xc800000000000000u, 0x0000000000000000u,
+    0xfa00000000000000u, 0x0000000000000000u,
+    0x9c40000000000000u, 0x0000000000000000u,
+    0xc350000000000000u, 0x0000000000000000u,
+    0xf424000000000000u, 0x0000000000000000u,
+    0x9896800000000000u, 0x0000000000000000u,
+    0xbebc200000000000u, 0x0000000000000000u,
+    0xee6b280000000000u, 0x0000000000000000u,
+    0x9502f90000000000u, 0x0000000000000000u,
+    0xba43b74000000000u, 0x0000000000000000u,
+    0xe8d4a51000000000u, 0x0000000000000000u,
+    0x9184e72a00000000u, 0x0000000000000000u,
+    0xb5e620f480000000u, 0x0000000000000000u,
+    0xe35fa931a0000000u, 0x0000000000000000u,
+    0x8e1bc9bf04000000u, 0x0000000000000000u,
+    0xb1a2bc2ec5000000u, 0x0000000000000000u,
+    0xde0b6b3a76400000u, 0x0000000000000000u,
+    0x8ac7230489e80000u, 0x0000000000000000u,
+    0xad78ebc5ac620000u, 0x0000000000000000u,
+    0xd8d726b7177a8000u, 0x0000000000000000u,
+    0x878678326eac9000u, 0x0000000000000000u,
+    0xa968163f0a57b400u, 0x0000000000000000u,
+    0xd3c21bcecceda100u, 0x0000000000000000u,
+    0x84595161401484a0u, 0x0000000000000000u,
+    0xa56fa5b99019a5c8u, 0x0000000000000000u,
+    0xcecb8f27f4200f3au, 0x0000000000000000u,
+    0x813f3978f8940984u, 0x4000000000000000u,
+    0xa18f07d736b90be5u, 0x5000000000000000u,
+    0xc9f2c9cd04674edeu, 0xa400000000000000u,
+    0xfc6f7c4045812296u, 0x4d00000000000000u,
+    0x9dc5ada82b70b59du, 0xf020000000000000u,
+    0xc5371912364ce305u, 0x6c28000000000000u,
+    0xf684df56c3e01bc6u, 0xc732000000000000u,
+    0x9a130b963a6c115cu, 0x3c7f400000000000u,
+    0xc097ce7bc90715b3u, 0x4b9f100000000000u,
+    0xf0bdc21abb48db20u, 0x1e86d40000000000u,
+    0x96769950b50d88f4u, 0x1314448000000000u,
+    0xbc143fa4e250eb31u, 0x17d955a000000000u,
+    0xeb194f8e1ae525fdu, 0x5dcfab0800000000u,
+    0x92efd1b8d0cf37beu, 0x5aa1cae500000000u,
+    0xb7abc627050305adu, 0xf14a3d9e40000000u,
+    0xe596b7b0c643c719u, 0x6d9ccd05d0000000u,
+    0x8f7e32ce7bea5c6fu, 0xe4820023a2000000u,
+    0xb35dbf821ae4f38bu, 0xdda2802c8a800000u,
+    0xe0352f62a19e306eu, 0xd50b2037ad200000u,
+    0x8c213d9da502de45u, 0x4526f422cc340000u,
+    0xaf298d050e4395d6u, 0x9670b12b7f410000u,
+    0xdaf3f04651d47b4cu, 0x3c0cdd765f114000u,
+    0x88d8762bf324cd0fu, 0xa5880a69fb6ac800u,
+    0xab0e93b6efee0053u, 0x8eea0d047a457a00u,
+    0xd5d238a4abe98068u, 0x72a4904598d6d880u,
+    0x85a36366eb71f041u, 0x47a6da2b7f864750u,
+    0xa70c3c40a64e6c51u, 0x999090b65f67d924u,
+    0xd0cf4b50cfe20765u, 0xfff4b4e3f741cf6du,
+    0x82818f1281ed449fu, 0xbff8f10e7a8921a4u,
+    0xa321f2d7226895c7u, 0xaff72d52192b6a0du,
+    0xcbea6f8ceb02bb39u, 0x9bf4f8a69f764490u,
+    0xfee50b7025c36a08u, 0x02f236d04753d5b4u,
+    0x9f4f2726179a2245u, 0x01d762422c946590u,
+    0xc722f0ef9d80aad6u, 0x424d3ad2b7b97ef5u,
+    0xf8ebad2b84e0d58bu, 0xd2e0898765a7deb2u,
+    0x9b934c3b330c8577u, 0x63cc55f49f88eb2fu,
+    0xc2781f49ffcfa6d5u, 0x3cbf6b71c76b25fbu,
+    0xf316271c7fc3908au, 0x8bef464e3945ef7au,
+    0x97edd871cfda3a56u, 0x97758bf0e3cbb5acu,
+    0xbde94e8e43d0c8ecu, 0x3d52eeed1cbea317u,
+    0xed63a231d4c4fb27u, 0x4ca7aaa863ee4bddu,
+    0x945e455f24fb1cf8u, 0x8fe8caa93e74ef6au,
+    0xb975d6b6ee39e436u, 0xb3e2fd538e122b44u,
+    0xe7d34c64a9c85d44u, 0x60dbbca87196b616u,
+    0x90e40fbeea1d3a4au, 0xbc8955e946fe31cdu,
+    0xb51d13aea4a488ddu, 0x6babab6398bdbe41u,
+    0xe264589a4dcdab14u, 0xc696963c7eed2dd1u,
+    0x8d7eb76070a08aecu, 0xfc1e1de5cf543ca2u,
+    0xb0de65388cc8ada8u, 0x3b25a55f43294bcbu,
+    0xdd15fe86affad912u, 0x49ef0eb713f39ebeu,
+    0x8a2dbf142dfcc7abu, 0x6e3569326c784337u,
+    0xacb92ed9397bf996u, 0x49c2c37f07965404u,
+    0xd7e77a8f87daf7fbu, 0xdc33745ec97be906u,
+    0x86f0ac99b4e8dafdu, 0x69a028bb3ded71a3u,
+    0xa8acd7c0222311bcu, 0xc40832ea0d68ce0cu,
+    0xd2d80db02aabd62bu, 0xf50a3fa490c30190u,
+    0x83c7088e1aab65dbu, 0x792667c6da79e0fau,
+    0xa4b8cab1a1563f52u, 0x577001b891185938u,
+    0xcde6fd5e09abcf26u, 0xed4c0226b55e6f86u,
+    0x80b05e5ac60b6178u, 0x544f8158315b05b4u,
+    0xa0dc75f1778e39d6u, 0x696361ae3db1c721u,
+    0xc913936dd571c84cu, 0x03bc3a19cd1e38e9u,
+    0xfb5878494ace3a5fu, 0x04ab48a04065c723u,
+    0x9d174b2dcec0e47bu, 0x62eb0d64283f9c76u,
+    0xc45d1df942711d9au, 0x3ba5d0bd324f8394u,
+    0xf5746577930d6500u, 0xca8f44ec7ee36479u,
+    0x9968bf6abbe85f20u, 0x7e998b13cf4e1ecbu,
+    0xbfc2ef456ae276e8u, 0x9e3fedd8c321a67eu,
+    0xefb3ab16c59b14a2u, 0xc5cfe94ef3ea101eu,
+    0x95d04aee3b80ece5u, 0xbba1f1d158724a12u,
+    0xbb445da9ca61281fu, 0x2a8a6e45ae8edc97u,
+    0xea1575143cf97226u, 0xf52d09d71a3293bdu,
+    0x924d692ca61be758u, 0x593c2626705f9c56u,
+    0xb6e0c377cfa2e12eu, 0x6f8b2fb00c77836cu,
+    0xe498f455c38b997au, 0x0b6dfb9c0f956447u,
+    0x8edf98b59a373fecu, 0x4724bd4189bd5eacu,
+    0xb2977ee300c50fe7u, 0x58edec91ec2cb657u,
+    0xdf3d5e9bc0f653e1u, 0x2f2967b66737e3edu,
+    0x8b865b215899f46cu, 0xbd79e0d20082ee74u,
+    0xae67f1e9aec07187u, 0xecd8590680a3aa11u,
+    0xda01ee641a708de9u, 0xe80e6f4820cc9495u,
+    0x884134fe908658b2u, 0x3109058d147fdcddu,
+    0xaa51823e34a7eedeu, 0xbd4b46f0599fd415u,
+    0xd4e5e2cdc1d1ea96u, 0x6c9e18ac7007c91au,
+    0x850fadc09923329eu, 0x03e2cf6bc604ddb0u,
+    0xa6539930bf6bff45u, 0x84db8346b786151cu,
+    0xcfe87f7cef46ff16u, 0xe612641865679a63u,
+    0x81f14fae158c5f6eu, 0x4fcb7e8f3f60c07eu,
+    0xa26da3999aef7749u, 0xe3be5e330f38f09du,
+    0xcb090c8001ab551cu, 0x5cadf5bfd3072cc5u,
+    0xfdcb4fa002162a63u, 0x73d9732fc7c8f7f6u,
+    0x9e9f11c4014dda7eu, 0x2867e7fddcdd9afau,
+    0xc646d63501a1511du, 0xb281e1fd541501b8u,
+    0xf7d88bc24209a565u, 0x1f225a7ca91a4226u,
+    0x9ae757596946075fu, 0x3375788de9b06958u,
+    0xc1a12d2fc3978937u, 0x0052d6b1641c83aeu,
+    0xf209787bb47d6b84u, 0xc0678c5dbd23a49au,
+    0x9745eb4d50ce6332u, 0xf840b7ba963646e0u,
+    0xbd176620a501fbffu, 0xb650e5a93bc3d898u,
+    0xec5d3fa8ce427affu, 0xa3e51f138ab4cebeu,
+    0x93ba47c980e98cdfu, 0xc66f336c36b10137u,
+    0xb8a8d9bbe123f017u, 0xb80b0047445d4184u,
+    0xe6d3102ad96cec1du, 0xa60dc059157491e5u,
+    0x9043ea1ac7e41392u, 0x87c89837ad68db2fu,
+    0xb454e4a179dd1877u, 0x29babe4598c311fbu,
+    0xe16a1dc9d8545e94u, 0xf4296dd6fef3d67au,
+    0x8ce2529e2734bb1du, 0x1899e4a65f58660cu,
+    0xb01ae745b101e9e4u, 0x5ec05dcff72e7f8fu,
+    0xdc21a1171d42645du, 0x76707543f4fa1f73u,
+    0x899504ae72497ebau, 0x6a06494a791c53a8u,
+    0xabfa45da0edbde69u, 0x0487db9d17636892u,
+    0xd6f8d7509292d603u, 0x45a9d2845d3c42b6u,
+    0x865b86925b9bc5c2u, 0x0b8a2392ba45a9b2u,
+    0xa7f26836f282b732u, 0x8e6cac7768d7141eu,
+    0xd1ef0244af2364ffu, 0x3207d795430cd926u,
+    0x8335616aed761f1fu, 0x7f44e6bd49e807b8u,
+    0xa402b9c5a8d3a6e7u, 0x5f16206c9c6209a6u,
+    0xcd036837130890a1u, 0x36dba887c37a8c0fu,
+    0x802221226be55a64u, 0xc2494954da2c9789u,
+    0xa02aa96b06deb0fdu, 0xf2db9baa10b7bd6cu,
+    0xc83553c5c8965d3du, 0x6f92829494e5acc7u,
+    0xfa42a8b73abbf48cu, 0xcb772339ba1f17f9u,
+    0x9c69a97284b578d7u, 0xff2a760414536efbu,
+    0xc38413cf25e2d70du, 0xfef5138519684abau,
+    0xf46518c2ef5b8cd1u, 0x7eb258665fc25d69u,
+    0x98bf2f79d5993802u, 0xef2f773ffbd97a61u,
+    0xbeeefb584aff8603u, 0xaafb550ffacfd8fau,
+    0xeeaaba2e5dbf6784u, 0x95ba2a53f983cf38u,
+    0x952ab45cfa97a0b2u, 0xdd945a747bf26183u,
+    0xba756174393d88dfu, 0x94f971119aeef9e4u,
+    0xe912b9d1478ceb17u, 0x7a37cd5601aab85du,
+    0x91abb422ccb812eeu, 0xac62e055c10ab33au,
+    0xb616a12b7fe617aau, 0x577b986b314d6009u,
+    0xe39c49765fdf9d94u, 0xed5a7e85fda0b80bu,
+    0x8e41ade9fbebc27du, 0x14588f13be847307u,
+    0xb1d219647ae6b31cu, 0x596eb2d8ae258fc8u,
+    0xde469fbd99a05fe3u, 0x6fca5f8ed9aef3bbu,
+    0x8aec23d680043beeu, 0x25de7bb9480d5854u,
+    0xada72ccc20054ae9u, 0xaf561aa79a10ae6au,
+    0xd910f7ff28069da4u, 0x1b2ba1518094da04u,
+    0x87aa9aff79042286u, 0x90fb44d2f05d0842u,
+    0xa99541bf57452b28u, 0x353a1607ac744a53u,
+    0xd3fa922f2d1675f2u, 0x42889b8997915ce8u,
+    0x847c9b5d7c2e09b7u, 0x69956135febada11u,
+    0xa59bc234db398c25u, 0x43fab9837e699095u,
+    0xcf02b2c21207ef2eu, 0x94f967e45e03f4bbu,
+    0x8161afb94b44f57du, 0x1d1be0eebac278f5u,
+    0xa1ba1ba79e1632dcu, 0x6462d92a69731732u,
+    0xca28a291859bbf93u, 0x7d7b8f7503cfdcfeu,
+    0xfcb2cb35e702af78u, 0x5cda735244c3d43eu,
+    0x9defbf01b061adabu, 0x3a0888136afa64a7u,
+    0xc56baec21c7a1916u, 0x088aaa1845b8fdd0u,
+    0xf6c69a72a3989f5bu, 0x8aad549e57273d45u,
+    0x9a3c2087a63f6399u, 0x36ac54e2f678864bu,
+    0xc0cb28a98fcf3c7fu, 0x84576a1bb416a7ddu,
+    0xf0fdf2d3f3c30b9fu, 0x656d44a2a11c51d5u,
+    0x969eb7c47859e743u, 0x9f644ae5a4b1b325u,
+    0xbc4665b596706114u, 0x873d5d9f0dde1feeu,
+    0xeb57ff22fc0c7959u, 0xa90cb506d155a7eau,
+    0x9316ff75dd87cbd8u, 0x09a7f12442d588f2u,
+    0xb7dcbf5354e9beceu, 0x0c11ed6d538aeb2fu,
+    0xe5d3ef282a242e81u, 0x8f1668c8a86da5fau,
+    0x8fa475791a569d10u, 0xf96e017d694487bcu,
+    0xb38d92d760ec4455u, 0x37c981dcc395a9acu,
+    0xe070f78d3927556au, 0x85bbe253f47b1417u,
+    0x8c469ab843b89562u, 0x93956d7478ccec8eu,
+    0xaf58416654a6babbu, 0x387ac8d1970027b2u,
+    0xdb2e51bfe9d0696au, 0x06997b05fcc0319eu,
+    0x88fcf317f22241e2u, 0x441fece3bdf81f03u,
+    0xab3c2fddeeaad25au, 0xd527e81cad7626c3u,
+    0xd60b3bd56a5586f1u, 0x8a71e223d8d3b074u,
+    0x85c7056562757456u, 0xf6872d5667844e49u,
+    0xa738c6bebb12d16cu, 0xb428f8ac016561dbu,
+    0xd106f86e69d785c7u, 0xe13336d701beba52u,
+    0x82a45b450226b39cu, 0xecc0024661173473u,
+    0xa34d721642b06084u, 0x27f002d7f95d0190u,
+    0xcc20ce9bd35c78a5u, 0x31ec038df7b441f4u,
+    0xff290242c83396ceu, 0x7e67047175a15271u,
+    0x9f79a169bd203e41u, 0x0f0062c6e984d386u,
+    0xc75809c42c684dd1u, 0x52c07b78a3e60868u,
+    0xf92e0c3537826145u, 0xa7709a56ccdf8a82u,
+    0x9bbcc7a142b17ccbu, 0x88a66076400bb691u,
+    0xc2abf989935ddbfeu, 0x6acff893d00ea435u,
+    0xf356f7ebf83552feu, 0x0583f6b8c4124d43u,
+    0x98165af37b2153deu, 0xc3727a337a8b704au,
+    0xbe1bf1b059e9a8d6u, 0x744f18c0592e4c5cu,
+    0xeda2ee1c7064130cu, 0x1162def06f79df73u,
+    0x9485d4d1c63e8be7u, 0x8addcb5645ac2ba8u,
+    0xb9a74a0637ce2ee1u, 0x6d953e2bd7173692u,
+    0xe8111c87c5c1ba99u, 0xc8fa8db6ccdd0437u,
+    0x910ab1d4db9914a0u, 0x1d9c9892400a22a2u,
+    0xb54d5e4a127f59c8u, 0x2503beb6d00cab4bu,
+    0xe2a0b5dc971f303au, 0x2e44ae64840fd61du,
+    0x8da471a9de737e24u, 0x5ceaecfed289e5d2u,
+    0xb10d8e1456105dadu, 0x7425a83e872c5f47u,
+    0xdd50f1996b947518u, 0xd12f124e28f77719u,
+    0x8a5296ffe33cc92fu, 0x82bd6b70d99aaa6fu,
+    0xace73cbfdc0bfb7bu, 0x636cc64d1001550bu,
+    0xd8210befd30efa5au, 0x3c47f7e05401aa4eu,
+    0x8714a775e3e95c78u, 0x65acfaec34810a71u,
+    0xa8d9d1535ce3b396u, 0x7f1839a741a14d0du,
+    0xd31045a8341ca07cu, 0x1ede48111209a050u,
+    0x83ea2b892091e44du, 0x934aed0aab460432u,
+    0xa4e4b66b68b65d60u, 0xf81da84d5617853fu,
+    0xce1de40642e3f4b9u, 0x36251260ab9d668eu,
+    0x80d2ae83e9ce78f3u, 0xc1d72b7c6b426019u,
+    0xa1075a24e4421730u, 0xb24cf65b8612f81fu,
+    0xc94930ae1d529cfcu, 0xdee033f26797b627u,
+    0xfb9b7cd9a4a7443cu, 0x169840ef017da3b1u,
+    0x9d412e0806e88aa5u, 0x8e1f289560ee864eu,
+    0xc491798a08a2ad4eu, 0xf1a6f2bab92a27e2u,
+    0xf5b5d7ec8acb58a2u, 0xae10af696774b1dbu,
+    0x9991a6f3d6bf1765u, 0xacca6da1e0a8ef29u,
+    0xbff610b0cc6edd3fu, 0x17fd090a58d32af3u,
+    0xeff394dcff8a948eu, 0xddfc4b4cef07f5b0u,
+    0x95f83d0a1fb69cd9u, 0x4abdaf101564f98eu,
+    0xbb764c4ca7a4440fu, 0x9d6d1ad41abe37f1u,
+    0xea53df5fd18d5513u, 0x84c86189216dc5edu,
+    0x92746b9be2f8552cu, 0x32fd3cf5b4e49bb4u,
+    0xb7118682dbb66a77u, 0x3fbc8c33221dc2a1u,
+    0xe4d5e82392a40515u, 0x0fabaf3feaa5334au,
+    0x8f05b1163ba6832du, 0x29cb4d87f2a7400eu,
+    0xb2c71d5bca9023f8u, 0x743e20e9ef511012u,
+    0xdf78e4b2bd342cf6u, 0x914da9246b255416u,
+    0x8bab8eefb6409c1au, 0x1ad089b6c2f7548eu,
+    0xae9672aba3d0c320u, 0xa184ac2473b529b1u,
+    0xda3c0f568cc4f3e8u, 0xc9e5d72d90a2741eu,
+    0x8865899617fb1871u, 0x7e2fa67c7a658892u,
+    0xaa7eebfb9df9de8du, 0xddbb901b98feeab7u,
+    0xd51ea6fa85785631u, 0x552a74227f3ea565u,
+    0x8533285c936b35deu, 0xd53a88958f87275fu,
+    0xa67ff273b8460356u, 0x8a892abaf368f137u,
+    0xd01fef10a657842cu, 0x2d2b7569b0432d85u,
+    0x8213f56a67f6b29bu, 0x9c3b29620e29fc73u,
+    0xa298f2c501f45f42u, 0x8349f3ba91b47b8fu,
+    0xcb3f2f7642717713u, 0x241c70a936219a73u,
+    0xfe0efb53d30dd4d7u, 0xed238cd383aa0110u,
+    0x9ec95d1463e8a506u, 0xf4363804324a40aau,
+    0xc67bb4597ce2ce48u, 0xb143c6053edcd0d5u,
+    0xf81aa16fdc1b81dau, 0xdd94b7868e94050au,
+    0x9b10a4e5e9913128u, 0xca7cf2b4191c8326u,
+    0xc1d4ce1f63f57d72u, 0xfd1c2f611f63a3f0u,
+    0xf24a01a73cf2dccfu, 0xbc633b39673c8cecu,
+    0x976e41088617ca01u, 0xd5be0503e085d813u,
+    0xbd49d14aa79dbc82u, 0x4b2d8644d8a74e18u,
+    0xec9c459d51852ba2u, 0xddf8e7d60ed1219eu,
+    0x93e1ab8252f33b45u, 0xcabb90e5c942b503u,
+    0xb8da1662e7b00a17u, 0x3d6a751f3b936243u,
+    0xe7109bfba19c0c9du, 0x0cc512670a783ad4u,
+    0x906a617d450187e2u, 0x27fb2b80668b24c5u,
+    0xb484f9dc9641e9dau, 0xb1f9f660802dedf6u,
+    0xe1a63853bbd26451u, 0x5e7873f8a0396973u,
+    0x8d07e33455637eb2u, 0xdb0b487b6423e1e8u,
+    0xb049dc016abc5e5fu, 0x91ce1a9a3d2cda62u,
+    0xdc5c5301c56b75f7u, 0x7641a140cc7810fbu,
+    0x89b9b3e11b6329bau, 0xa9e904c87fcb0a9du,
+    0xac2820d9623bf429u, 0x546345fa9fbdcd44u,
+    0xd732290fbacaf133u, 0xa97c177947ad4095u,
+    0x867f59a9d4bed6c0u, 0x49ed8eabcccc485du,
+    0xa81f301449ee8c70u, 0x5c68f256bfff5a74u,
+    0xd226fc195c6a2f8cu, 0x73832eec6fff3111u,
+    0x83585d8fd9c25db7u, 0xc831fd53c5ff7eabu,
+    0xa42e74f3d032f525u, 0xba3e7ca8b77f5e55u,
+    0xcd3a1230c43fb26fu, 0x28ce1bd2e55f35ebu,
+    0x80444b5e7aa7cf85u, 0x7980d163cf5b81b3u,
+    0xa0555e361951c366u, 0xd7e105bcc332621fu,
+    0xc86ab5c39fa63440u, 0x8dd9472bf3fefaa7u,
+    0xfa856334878fc150u, 0xb14f98f6f0feb951u,
+    0x9c935e00d4b9d8d2u, 0x6ed1bf9a569f33d3u,
+    0xc3b8358109e84f07u, 0x0a862f80ec4700c8u,
+    0xf4a642e14c6262c8u, 0xcd27bb612758c0fau,
+    0x98e7e9cccfbd7dbdu, 0x8038d51cb897789cu,
+    0xbf21e44003acdd2cu, 0xe0470a63e6bd56c3u,
+    0xeeea5d5004981478u, 0x1858ccfce06cac74u,
+    0x95527a5202df0ccbu, 0x0f37801e0c43ebc8u,
+    0xbaa718e68396cffdu, 0xd30560258f54e6bau,
+    0xe950df20247c83fdu, 0x47c6b82ef32a2069u,
+    0x91d28b7416cdd27eu, 0x4cdc331d57fa5441u,
+    0xb6472e511c81471du, 0xe0133fe4adf8e952u,
+    0xe3d8f9e563a198e5u, 0x58180fddd97723a6u,
+    0x8e679c2f5e44ff8fu, 0x570f09eaa7ea7648u
+};
+
+/* Powers of ten exactly representable as doubles */
+static const double exact_powers_of_ten _Checked[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Returns low 64 bits of a 128-bit product and stores its high 64 bits */
+static uint64_t multiply_u64(uint64_t a, uint64_t b, _Ptr<uint64_t> high) {
+#if defined(__SIZEOF_INT128__)
+    parson_uint128_t product = (parson_uint128_t)a * b;
+    *high = (uint64_t)(product >> 64);
+    return (uint64_t)product;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    *high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+#endif
+}
+
+static int count_leading_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while ((x & ((uint64_t)1 << 63)) == 0) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* Exact for exponent10 in [-1000, 1000] */
+static int floor_log2_pow10(int exponent10) {
+    int32_t scaled = (152170 + 65536) * exponent10; /* log2(10) * 2^16 */
+    /* floor division, right shift of negative numbers is implementation defined */
+    return scaled >= 0 ? scaled / 65536 : -((-scaled + 65535) / 65536);
+}
+
+/* Exact for exponent2 in [-1600, 1600], computed without libm */
+static int ceil_log10_pow2(int exponent2) {
+    int32_t scaled = 78913 * exponent2; /* log10(2) * 2^18 */
+    return scaled >= 0 ? (scaled + 262143) / 262144 : -(-scaled / 262144);
+}
+
+/* Eisel-Lemire algorithm (https://arxiv.org/abs/2101.11408), as implemented by fast_float.
+   Converts nonzero mantissa * 10^exponent10 to the nearest double. Returns 0 if the result
+   is subnormal or infinite, or if the approximation can't decide rounding, those cases are
+   left to strtod. */
+static int eisel_lemire(uint64_t mantissa, int exponent10, int negative, _Ptr<double> result) {
+    size_t index = 2 * (size_t)(exponent10 - POWER_OF_FIVE_MIN_EXPONENT);
+    int leading_zeros = count_leading_zeros(mantissa);
+    uint64_t high = 0, low = 0, second_high = 0;
+    union { uint64_t bits; double number; } converter;
+    int upper_bit = 0, shift = 0, power2 = 0;
+    mantissa <<= leading_zeros;
+    low = multiply_u64(mantissa, power_of_five_128[index], &high);
+    if ((high & 0x1FF) == 0x1FF) { /* lower bits may be affected by truncation of 5^q, use more of it */
+        multiply_u64(mantissa, power_of_five_128[index + 1], &second_high);
+        low += second_high;
+        if (second_high > low) {
+            high++;
+        }
+        if (low == 0xFFFFFFFFFFFFFFFFu && (exponent10 < -27 || exponent10 > 55)) {
+            return 0;
+        }
+    }
+    upper_bit = (int)(high >> 63);
+    shift = upper_bit + 64 - 52 - 3;
+    mantissa = high >> shift;
+    /* floor division, right shift of negative numbers is implementation defined */
+    power2 = floor_log2_pow10(exponent10) + 63 + upper_bit - leading_zeros + 1023;
+    if (power2 <= 0) {
+        return 0;
+    }
+    /* round half to even if the product is exact, which can happen only for small exponents */
+    if (low <= 1 && exponent10 >= -4 && exponent10 <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)2 << 52)) {
+        mantissa = (uint64_t)1 << 52;
+        power2++;
+    }
+    mantissa &= ~((uint64_t)1 << 52);
+    if (power2 >= 0x7FF) {
+        return 0;
+    }
+    converter.bits = mantissa | ((uint64_t)power2 << 52) | ((uint64_t)(negative ? 1 : 0) << 63);
+    *result = converter.number;
+    return 1;
+}
+
+/* Parses number as defined by JSON grammar and skips it. Integers which fit in 64 bits are stored
+   in number->integer or number->uinteger and flags is set accordingly, other numbers are stored
+   in number->number. Numbers with up to 19 significant digits are converted exactly without
+   strtod, which is used only if a fast path can't be taken.
+   TODO: Scanning digits needs pointer arithmetic the compiler can't check. */
+static _Unchecked JSON_Status parse_number(const char** string : itype(_Ptr<_Nt_array_ptr<const char>>), _Ptr<JSON_Value_Value> number, _Ptr<int> flags) {
+    const char *ptr = *string;
+    const char *end = NULL;
+    uint64_t mantissa = 0;
+    int digits = 0; /* significant digits in mantissa */
+    int truncated = 0;
+    int negative = 0;
+    int exponent10 = 0;
+    int explicit_exponent = 0;
+    int explicit_exponent_negative = 0;
+    const char *integer_start = NULL;
+    *flags = 0;
+    if (*ptr == '-') {
+        negative = 1;
+        ptr++;
+    }
+    if (*ptr == '0') {
+        ptr++;
+        if (IS_DIGIT(*ptr) || *ptr == 'x' || *ptr == 'X') {
+            return JSONFailure; /* leading zeros and hex numbers aren't allowed */
+        }
+    } else if (*ptr >= '1' && *ptr <= '9') {
+        integer_start = ptr;
+        while (IS_DIGIT(*ptr)) {
+            if (digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (uint64_t)(*ptr - '0');
+                digits++;
+            } else {
+                truncated = 1;
+            }
+            ptr++;
+        }
+    } else {
+        return JSONFailure;
+    }
+    if (*ptr != '.' && *ptr != 'e' && *ptr != 'E' && !(negative && mantissa == 0)) { /* -0 is kept as double */
+        if (truncated && ptr - integer_start == MAX_MANTISSA_DIGITS + 1 &&
+            mantissa <= (UINT64_MAX - (uint64_t)(ptr[-1] - '0')) / 10) {
+            mantissa = mantissa * 10 + (uint64_t)(ptr[-1] - '0');
+            truncated = 0;
+        }
+        if (!truncated && !negative && mantissa > (uint64_t)INT64_MAX) {
+            number->uinteger = mantissa;
+            *flags = VALUE_FLAG_UINT64;
+            *string = ptr;
+            return JSONSuccess;
+        } else if (!truncated && mantissa <= (uint64_t)INT64_MAX + negative) {
+            /* negation is done in unsigned arithmetic so INT64_MIN doesn't overflow */
+            mantissa = negative ? (uint64_t)0 - mantissa : mantissa;
+            number->integer = mantissa > (uint64_t)INT64_MAX ? -(int64_t)(~mantissa) - 1 : (int64_t)mantissa;
+            *flags = VALUE_FLAG_INT64;
+            *string = ptr;
+            return JSONSuccess;
+        }
+    }
+    if (*ptr == '.') {
+        ptr++;
+        if (!IS_DIGIT(*ptr)) {
+            return JSONFailure;
+        }
+        while (IS_DIGIT(*ptr)) {
+            if (digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (uint64_t)(*ptr - '0');
+                exponent10--;
+                if (mantissa != 0) { /* leading zeros aren't significant */
+                    digits++;
+                }
+            } else {
+                truncated = 1;
+            }
+            ptr++;
+        }
+    }
+    if (*ptr == 'e' || *ptr == 'E') {
+        ptr++;
+        if (*ptr == '-' || *ptr == '+') {
+            explicit_exponent_negative = *ptr == '-';
+            ptr++;
+        }
+        if (!IS_DIGIT(*ptr)) {
+            return JSONFailure;
+        }
+        while (IS_DIGIT(*ptr)) {
+            if (explicit_exponent < 100000) { /* way out of range of doubles anyway */
+                explicit_exponent = explicit_exponent * 10 + (*ptr - '0');
+            }
+            ptr++;
+        }
+        exponent10 += explicit_exponent_negative ? -explicit_exponent : explicit_exponent;
+    }
+    if (!truncated) {
+        if (mantissa == 0) {
+            number->number = negative ? -0.0 : 0.0;
+            *string = ptr;
+            return JSONSuccess;
+        }
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+        /* both operands and the result are exact, so there's a single rounding (Clinger's fast path) */
+        if (mantissa <= ((uint64_t)1 << 53) && exponent10 >= -22 && exponent10 <= 22) {
+            number->number = (double)mantissa;
+            if (exponent10 < 0) {
+                number->number /= exact_powers_of_ten[-exponent10];
+            } else {
+                number->number *= exact_powers_of_ten[exponent10];
+            }
+            if (negative) {
+                number->number = -number->number;
+            }
+            *string = ptr;
+            return JSONSuccess;
+        }
+#endif
+        if (exponent10 >= POWER_OF_FIVE_MIN_EXPONENT && exponent10 <= POWER_OF_FIVE_MAX_EXPONENT &&
+            eisel_lemire(mantissa, exponent10, negative, &number->number)) {
+            *string = ptr;
+            return JSONSuccess;
+        }
+    }
+    /* strtod stops at the same place as the scan above for any valid JSON number */
+    errno = 0;
+    number->number = strtod(*string, (char**)&end);
+    if (errno || end != ptr) {
+        return JSONFailure;
+    }
+    *string = ptr;
     return JSONSuccess;
 }
 
+static const char digit_pairs _Nt_checked[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Writes integer to buf (which has to fit at least 22 characters) and returns number of written
+   characters, not counting terminating null character. Digits are produced two at a time from
+   the end, which is considerably faster than sprintf.
+   TODO: Writing at computed offsets isn't expressible with checked pointers. */
+static _Unchecked int format_integer(char *buf : itype(_Nt_array_ptr<char>), uint64_t magnitude, int negative) {
+    char digits[20];
+    size_t start = sizeof(digits), pair = 0;
+    int written = 0;
+    while (magnitude >= 100) {
+        pair = (size_t)(magnitude % 100) * 2;
+        magnitude /= 100;
+        digits[--start] = digit_pairs[pair + 1];
+        digits[--start] = digit_pairs[pair];
+    }
+    if (magnitude >= 10) {
+        pair = (size_t)magnitude * 2;
+        digits[--start] = digit_pairs[pair + 1];
+        digits[--start] = digit_pairs[pair];
+    } else {
+        digits[--start] = (char)('0' + magnitude);
+    }
+    if (negative) {
+        buf[written++] = '-';
+    }
+    memcpy(buf + written, digits + start, sizeof(digits) - start);
+    written += (int)(sizeof(digits) - start);
+    buf[written] = '\0';
+    return written;
+}
+
+static const uint32_t small_powers_of_ten _Checked[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/* Product rounded to 64 bits */
+static JSON_Diy_Fp diy_fp_multiply(JSON_Diy_Fp a, JSON_Diy_Fp b) {
+    JSON_Diy_Fp result = { 0, 0 };
+    uint64_t high = 0;
+    uint64_t low = multiply_u64(a.significand, b.significand, &high);
+    result.significand = high + (low >> 63);
+    result.exponent = a.exponent + b.exponent + 64;
+    return result;
+}
+
+/* Moves last digit closer to the exact value as long as it stays inside the rounding interval */
+static void grisu_round(char *digits : itype(_Array_ptr<char>) count(length), int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance) {
+    while (rest < distance && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance)) {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+/* Generates the shortest digits of a number inside (upper - delta, upper), w being the scaled
+   value itself, and adds the position of the last digit to exponent10. */
+static int grisu_generate_digits(JSON_Diy_Fp w, JSON_Diy_Fp upper, uint64_t delta, char *digits : itype(_Array_ptr<char>) count(18), _Ptr<int> exponent10) {
+    int shift = -upper.exponent; /* in [57, 60] thanks to choice of cached power in grisu2 */
+    uint64_t one = (uint64_t)1 << shift;
+    uint64_t distance = upper.significand - w.significand;
+    uint32_t integral = (uint32_t)(upper.significand >> shift);
+    uint64_t fractional = upper.significand & (one - 1);
+    uint64_t rest = 0;
+    uint32_t digit = 0;
+    int kappa = 0, length = 0;
+    while (kappa < 10 && integral >= small_powers_of_ten[kappa]) {
+        kappa++;
+    }
+    while (kappa > 0) {
+        kappa--;
+        digit = integral / small_powers_of_ten[kappa];
+        integral %= small_powers_of_ten[kappa];
+        if (digit != 0 || length != 0) {
+            digits[length++] = (char)('0' + digit);
+        }
+        rest = ((uint64_t)integral << shift) + fractional;
+        if (rest <= delta) {
+            *exponent10 += kappa;
+            grisu_round(_Dynamic_bounds_cast<_Array_ptr<char>>(digits, count(length)), length, delta, rest, (uint64_t)small_powers_of_ten[kappa] << shift, distance);
+            return length;
+        }
+    }
+    while (length < 17) {
+        fractional *= 10;
+        delta *= 10;
+        distance *= 10;
+        digit = (uint32_t)(fractional >> shift);
+        if (digit != 0 || length != 0) {
+            digits[length++] = (char)('0' + digit);
+        }
+        fractional &= one - 1;
+        kappa--;
+        if (fractional < delta) {
+            *exponent10 += kappa;
+            grisu_round(_Dynamic_bounds_cast<_Array_ptr<char>>(digits, count(length)), length, delta, fractional, one, distance);
+            return length;
+        }
+    }
+    return 0; /* can't happen for correct input */
+}
+
+/* Grisu2 algorithm by Florian Loitsch (https://dl.acm.org/doi/10.1145/1809028.1806623), based on
+   Milo Yip's implementation. Writes up to 17 digits of shortest (in almost all cases) decimal
+   representation of positive number that parses back to the same double, so that
+   number == digits * 10^exponent10. Returns number of digits or 0 if it can't be used, which
+   is the case for very small numbers that would need powers of ten outside power_of_five_128. */
+static int grisu2(double number, char *digits : itype(_Array_ptr<char>) count(18), _Ptr<int> exponent10) {
+    union { double number; uint64_t bits; } converter;
+    JSON_Diy_Fp value = { 0, 0 }, upper = { 0, 0 }, lower = { 0, 0 }, cached = { 0, 0 }, w = { 0, 0 };
+    int biased_exponent = 0, power = 0, shift = 0;
+    size_t index = 0;
+    uint64_t high = 0, low = 0;
+    converter.number = number;
+    biased_exponent = (int)((converter.bits >> 52) & 0x7FF);
+    value.significand = converter.bits & (((uint64_t)1 << 52) - 1);
+    if (biased_exponent != 0) {
+        value.significand |= (uint64_t)1 << 52;
+        value.exponent = biased_exponent - 1075;
+    } else {
+        value.exponent = -1074;
+    }
+    /* boundaries of the interval rounding to number, with the same exponent */
+    upper.significand = (value.significand << 1) + 1;
+    upper.exponent = value.exponent - 1;
+    shift = count_leading_zeros(upper.significand);
+    upper.significand <<= shift;
+    upper.exponent -= shift;
+    if (value.significand == ((uint64_t)1 << 52) && biased_exponent > 1) { /* lower neighbour is closer */
+        lower.significand = (value.significand << 2) - 1;
+        lower.exponent = value.exponent - 2;
+    } else {
+        lower.significand = (value.significand << 1) - 1;
+        lower.exponent = value.exponent - 1;
+    }
+    lower.significand <<= lower.exponent - upper.exponent;
+    lower.exponent = upper.exponent;
+    shift = count_leading_zeros(value.significand);
+    value.significand <<= shift;
+    value.exponent -= shift;
+
+    /* 10^power chosen so that scaled upper exponent is in [-60, -57] */
+    power = ceil_log10_pow2(-61 - upper.exponent);
+    if (power > POWER_OF_FIVE_MAX_EXPONENT) {
+        return 0;
+    }
+    index = 2 * (size_t)(power - POWER_OF_FIVE_MIN_EXPONENT);
+    high = power_of_five_128[index];
+    low = power_of_five_128[index + 1];
+    cached.significand = high + ((low >> 63) & (high != UINT64_MAX)); /* 10^power == 5^power * 2^power */
+    cached.exponent = floor_log2_pow10(power) - 63;
+    w = diy_fp_multiply(value, cached);
+    upper = diy_fp_multiply(upper, cached);
+    lower = diy_fp_multiply(lower, cached);
+    upper.significand--; /* stay inside interval despite rounding errors */
+    lower.significand++;
+    *exponent10 = -power;
+    return grisu_generate_digits(w, upper, upper.significand - lower.significand, digits, exponent10);
+}
+
+/* Writes number the same way as printf("%.17g") would (fixed notation for decimal exponents in
+   [-4, 16], scientific otherwise), but with the shortest digits that parse back to the same
+   double. buf has to fit at least 26 characters. Returns number of written characters.
+   TODO: Writing at computed offsets isn't expressible with checked pointers. */
+static _Unchecked int format_double(char *buf : itype(_Nt_array_ptr<char>), double number) {
+    char digits[18];
+    int length = 0, exponent10 = 0, point = 0, written = 0, i = 0;
+    double magnitude = number < 0 ? -number : number;
+    if (magnitude < 9007199254740992.0 && (double)(uint64_t)magnitude == magnitude) { /* integral and exact */
+        return format_integer(buf, (uint64_t)magnitude, signbit(number));
+    }
+    length = grisu2(magnitude, digits, &exponent10);
+    if (length == 0) {
+        return sprintf(buf, FLOAT_FORMAT, number);
+    }
+    if (number < 0) {
+        buf[written++] = '-';
+    }
+    point = length + exponent10; /* digits before decimal point */
+    if (point > -4 && point <= 17) {
+        if (point <= 0) {
+            buf[written++] = '0';
+            buf[written++] = '.';
+            for (i = point; i < 0; i++) {
+                buf[written++] = '0';
+            }
+            memcpy(buf + written, digits, length);
+            written += length;
+        } else if (point >= length) {
+            memcpy(buf + written, digits, length);
+            written += length;
+            for (i = length; i < point; i++) {
+                buf[written++] = '0';
+            }
+        } else {
+            memcpy(buf + written, digits, point);
+            written += point;
+            buf[written++] = '.';
+            memcpy(buf + written, digits + point, length - point);
+            written += length - point;
+        }
+    } else {
+        buf[written++] = digits[0];
+        if (length > 1) {
+            buf[written++] = '.';
+            memcpy(buf + written, digits + 1, length - 1);
+            written += length - 1;
+        }
+        written += sprintf(buf + written, "e%c%02d", point - 1 < 0 ? '-' : '+', abs(point - 1));
+    }
+    buf[written] = '\0';
+    return written;
+}
+
+/* Parser */
+/* Vectorized whitespace skipping. Loads are aligned, so they don't cross a page boundary
+   and may safely read past the terminating '\0', which isn't whitespace and ends the scan. */
+#if defined(PARSON_SIMD_X86)
+static int cpu_features(void) {
+    int features = 0;
+    if (parson_cpu_features >= 0) {
+        return parson_cpu_features;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        features |= CPU_FEATURE_AVX2;
+    }
+    parson_cpu_features = features;
+    return features;
+}
+
+PARSON_NO_SANITIZE_ADDRESS
+static _Unchecked const char * skip_whitespaces_sse2(const char *string) {
+    const char *chunk = (const char*)((uintptr_t)string & ~(uintptr_t)15);
+    unsigned int mask = 0xFFFFu << (string - chunk); /* ignores bytes before the string */
+    __m128i bytes, whitespace;
+    unsigned int non_whitespace;
+    for (;;) {
+        bytes = _mm_load_si128((const __m128i*)chunk);
+        whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                                               _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')),
+                                               _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))));
+        non_whitespace = ~(unsigned int)_mm_movemask_epi8(whitespace) & mask;
+        if (non_whitespace != 0) {
+            return chunk + __builtin_ctz(non_whitespace);
+        }
+        chunk += 16;
+        mask = 0xFFFFu;
+    }
+}
+
+PARSON_NO_SANITIZE_ADDRESS __attribute__((target("avx2")))
+static _Unchecked const char * skip_whitespaces_avx2(const char *string) {
+    const char *chunk = (const char*)((uintptr_t)string & ~(uintptr_t)31);
+    unsigned int mask = 0xFFFFFFFFu << (string - chunk);
+    __m256i bytes, whitespace;
+    unsigned int non_whitespace;
+    for (;;) {
+        bytes = _mm256_load_si256((const __m256i*)chunk);
+        whitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                                                     _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r')),
+                                                     _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))));
+        non_whitespace = ~(unsigned int)_mm256_movemask_epi8(whitespace) & mask;
+        if (non_whitespace != 0) {
+            return chunk + __builtin_ctz(non_whitespace);
+        }
+        chunk += 32;
+        mask = 0xFFFFFFFFu;
+    }
+}
+#elif defined(PARSON_SIMD_NEON)
+PARSON_NO_SANITIZE_ADDRESS
+static _Unchecked const char * skip_whitespaces_neon(const char *string) {
+    const char *chunk = (const char*)((uintptr_t)string & ~(uintptr_t)15);
+    uint64_t mask = ~(uint64_t)0 << ((string - chunk) * 4); /* 4 bits per byte, see below */
+    uint8x16_t bytes, whitespace;
+    uint64_t non_whitespace;
+    for (;;) {
+        bytes = vld1q_u8((const uint8_t*)chunk);
+        whitespace = vorrq_u8(vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(' ')), vceqq_u8(bytes, vdupq_n_u8('\n'))),
+                              vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\r')), vceqq_u8(bytes, vdupq_n_u8('\t'))));
+        /* NEON has no movemask, narrowing shift packs comparison of each byte into a nibble */
+        non_whitespace = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(whitespace), 4)), 0) & mask;
+        if (non_whitespace != 0) {
+            return chunk + (__builtin_ctzll(non_whitespace) >> 2);
+        }
+        chunk += 16;
+        mask = ~(uint64_t)0;
+    }
+}
+#endif
+
+static _Nt_array_ptr<const char> skip_whitespaces(_Nt_array_ptr<const char> string) {
+    /* No whitespace or a single space is the most common case between tokens */
+    if (!IS_WHITESPACE(string[0])) {
+        return string;
+    }
+    if (!IS_WHITESPACE(string[1])) {
+        return string + 1;
+    }
+    // TODO: Vectorized scanning can't be expressed in checked code.
+    _Unchecked {
+        const char *result = (const char*)string;
+#if defined(PARSON_SIMD_X86)
+        if (cpu_features() & CPU_FEATURE_AVX2) {
+            result = skip_whitespaces_avx2(result);
+        } else {
+            result = skip_whitespaces_sse2(result);
+        }
+#elif defined(PARSON_SIMD_NEON)
+        result = skip_whitespaces_neon(result);
+#else
+        while (IS_WHITESPACE(*result)) {
+            result++;
+        }
+#endif
+        return _Assume_bounds_cast<_Nt_array_ptr<const char>>(result, count(0));
+    }
+}
+
+/* Vectorized string scanning, same as skipping whitespace above */
+#if defined(PARSON_SIMD_X86)
+PARSON_NO_SANITIZE_ADDRESS
+static _Unchecked const char * scan_string_sse2(const char *string, const char *end, char stop) {
+    const char *chunk = (const char*)((uintptr_t)string & ~(uintptr_t)15);
+    unsigned int mask = 0xFFFFu << (string - chunk);
+    __m128i bytes, special;
+    unsigned int found;
+    for (;;) {
+        bytes = _mm_load_si128((const __m128i*)chunk);
+        special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\"')),
+                                            _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'))),
+                               _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(stop)),
+                                            _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F)))); /* bytes <= 0x1F */
+        found = (unsigned int)_mm_movemask_epi8(special) & mask;
+        if (found != 0) {
+            chunk += __builtin_ctz(found);
+            return end != NULL && chunk > end ? end : chunk;
+        }
+        chunk += 16;
+        if (end != NULL && chunk >= end) {
+            return end;
+        }
+        mask = 0xFFFFu;
+    }
+}
+
+PARSON_NO_SANITIZE_ADDRESS __attribute__((target("avx2")))
+static _Unchecked const char * scan_string_avx2(const char *string, const char *end, char stop) {
+    const char *chunk = (const char*)((uintptr_t)string & ~(uintptr_t)31);
+    unsigned int mask = 0xFFFFFFFFu << (string - chunk);
+    __m256i bytes, special;
+    unsigned int found;
+    for (;;) {
+        bytes = _mm256_load_si256((const __m256i*)chunk);
+        special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\"')),
+                                                  _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'))),
+                                  _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(stop)),
+                                                  _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F))));
+        found = (unsigned int)_mm256_movemask_epi8(special) & mask;
+        if (found != 0) {
+            chunk += __builtin_ctz(found);
+            return end != NULL && chunk > end ? end : chunk;
+        }
+        chunk += 32;
+        if (end != NULL && chunk >= end) {
+            return end;
+        }
+        mask = 0xFFFFFFFFu;
+    }
+}
+#elif defined(PARSON_SIMD_NEON)
+PARSON_NO_SANITIZE_ADDRESS
+static _Unchecked const char * scan_string_neon(const char *string, const char *end, char stop) {
+    const char *chunk = (const char*)((uintptr_t)string & ~(uintptr_t)15);
+    uint64_t mask = ~(uint64_t)0 << ((string - chunk) * 4);
+    uint8x16_t bytes, special;
+    uint64_t found;
+    for (;;) {
+        bytes = vld1q_u8((const uint8_t*)chunk);
+        special = vorrq_u8(vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\"')), vceqq_u8(bytes, vdupq_n_u8('\\'))),
+                           vorrq_u8(vceqq_u8(bytes, vdupq_n_u8((uint8_t)stop)), vcltq_u8(bytes, vdupq_n_u8(0x20))));
+        found = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0) & mask;
+        if (found != 0) {
+            chunk += (__builtin_ctzll(found) >> 2);
+            return end != NULL && chunk > end ? end : chunk;
+        }
+        chunk += 16;
+        if (end != NULL && chunk >= end) {
+            return end;
+        }
+        mask = ~(uint64_t)0;
+    }
+}
+#endif
+
+/* Returns first quote, backslash, stop or control character (including the terminating '\0'),
+   or end if there's none before it. end may be NULL to scan up to the terminator.
+   Parser passes a quote as stop, serializer passes a slash if slashes are escaped. */
+static _Unchecked const char * scan_string(const char *string, const char *end, char stop) {
+#if defined(PARSON_SIMD_X86)
+    if (cpu_features() & CPU_FEATURE_AVX2) {
+        return scan_string_avx2(string, end, stop);
+    }
+    return scan_string_sse2(string, end, stop);
+#elif defined(PARSON_SIMD_NEON)
+    return scan_string_neon(string, end, stop);
+#else
+    while (string != end && *string != '\"' && *string != '\\' && *string != stop && (unsigned char)*string >= 0x20) {
+        string++;
+    }
+    return string;
+#endif
+}
+
 // TODO: Needs bounds-widening to be checkable
 static int _Unchecked parse_utf16(const char** unprocessed : itype(_Ptr<_Nt_array_ptr<const char>>), char** processed : itype(_Ptr<_Nt_array_ptr<char>>)) {
     unsigned int cp, lead, trail;
@@ -692,21 +2778,27 @@ static int _Unchecked parse_utf16(const char** unprocessed : itype(_Ptr<_Nt_arra
 }
 
 
-/* Copies and processes passed string up to supplied length.
+/* Processes passed string up to supplied length into output, which has to have the exact length
+of the result computed by get_quoted_string. Output can be the input itself, since processed
+strings are never longer than their input. Runs between escapes are copied at once.
 Example: "\u006Corem ipsum" -> lorem ipsum */
-static _Nt_array_ptr<char> process_string(_Nt_array_ptr<const char> input : count(len), size_t len) {
-    _Nt_array_ptr<const char> input_ptr : bounds(input, input + len) = input;
-    size_t initial_size = (len + 1) * sizeof(char);
-    size_t final_size = 0;
-    _Nt_array_ptr<char> output : count(initial_size) = NULL;
-    output = parson_string_malloc(initial_size);
-    _Nt_array_ptr<char> output_ptr : bounds(output, output + initial_size) = NULL;
-    if (output == NULL) {
-        goto error;
-    }
-    output_ptr = output;
-    while ((*input_ptr != '\0') && (size_t)(input_ptr - input) < len) {
-        if (*input_ptr == '\\') {
+static JSON_Status unescape_string(_Nt_array_ptr<const char> input : count(input_len), size_t input_len, _Nt_array_ptr<char> output : count(output_len), size_t output_len) {
+    // TODO: Copying runs needs pointer arithmetic the compiler can't check.
+    _Unchecked {
+        const char *input_ptr = (const char*)input;
+        const char *input_end = input_ptr + input_len;
+        const char *escape = NULL;
+        char *output_ptr = (char*)output;
+        size_t run_len = 0;
+        while (input_ptr < input_end) {
+            escape = (const char*)memchr(input_ptr, '\\', (size_t)(input_end - input_ptr));
+            run_len = escape != NULL ? (size_t)(escape - input_ptr) : (size_t)(input_end - input_ptr);
+            memmove(output_ptr, input_ptr, run_len);
+            output_ptr += run_len;
+            input_ptr += run_len;
+            if (escape == NULL) {
+                break;
+            }
             input_ptr++;
             switch (*input_ptr) {
                 case '\"': *output_ptr = '\"'; break;
@@ -717,270 +2809,1283 @@ static _Nt_array_ptr<char> process_string(_Nt_array_ptr<const char> input : coun
                 case 'n':  *output_ptr = '\n'; break;
                 case 'r':  *output_ptr = '\r'; break;
                 case 't':  *output_ptr = '\t'; break;
-                case 'u': /*HACK for C3*/
-                    _Unchecked {
-                        const char *input_tmp = (const char *) input_ptr;
-                        char *output_tmp = (char *) output_ptr;
-                        if (parse_utf16(&input_tmp, &output_tmp) == JSONFailure) {
-                            goto error;
-                        }
-                        input_ptr = _Assume_bounds_cast<_Nt_array_ptr<const char>>(input_tmp, bounds(input, input + len));
-                        output_ptr = _Assume_bounds_cast<_Nt_array_ptr<char>>(output_tmp, bounds(output, output + initial_size));
-                        break;
+                case 'u':
+                    if (parse_utf16(&input_ptr, &output_ptr) == JSONFailure) {
+                        return JSONFailure;
                     }
+                    break;
                 default:
-                    goto error;
+                    return JSONFailure;
             }
-        } else if ((unsigned char)*input_ptr < 0x20) {
-            goto error; /* 0x00-0x19 are invalid characters for json string (http://www.ietf.org/rfc/rfc4627.txt) */
-        } else {
-            *output_ptr = *input_ptr;
-        }
-        output_ptr++;
-        input_ptr++;
-    }
-    *output_ptr = '\0';
-    /* resize to new length */
-    final_size = (size_t)(output_ptr-output) + 1;
-    /* todo: don't resize if final_size == initial_size */
-    _Nt_array_ptr<char> resized_output : count(final_size) = parson_string_malloc(final_size);
-    if (resized_output == NULL) {
-        goto error;
-    }
-    memcpy<char>(resized_output, _Dynamic_bounds_cast<_Nt_array_ptr<char>>(output, count(final_size)), final_size);
-    parson_free(char, output);
-    return resized_output;
-error:
-    parson_free(char, output);
-    return NULL;
-}
-
-/* Return processed contents of a string between quotes and
-   skips passed argument to a matching quote. */
-static _Nt_array_ptr<char> get_quoted_string(_Ptr<_Nt_array_ptr<const char>> string) {
-    _Nt_array_ptr<const char> string_start = *string;
-
-    size_t string_len = 0;
-    JSON_Status status = skip_quotes(string);
-    if (status != JSONSuccess) {
-        return NULL;
-    }
-    string_len = *string - string_start - 2; /* length without quotes */
-    // TODO: We can't figure this out dynamically
-    _Nt_array_ptr<const char> one_past_start : count(string_len) = NULL;
-    _Unchecked {
-        one_past_start = _Assume_bounds_cast<_Nt_array_ptr<const char>>(string_start + 1, count(string_len));
+            output_ptr++;
+            input_ptr++;
+        }
+        if (output_ptr != (char*)output + output_len) {
+            return JSONFailure; /* Shouldn't happen */
+        }
+        *output_ptr = '\0';
     }
-    return process_string(one_past_start, string_len);
+    return JSONSuccess;
 }
 
-static _Ptr<JSON_Value> parse_value(_Ptr<_Nt_array_ptr<const char>> string, size_t nesting) {
-    if (nesting > MAX_NESTING) {
-        return NULL;
+/* Finds closing quote of a string and skips passed argument to it. The string is scanned once,
+   which also gives the exact length of its processed contents.
+   TODO: Scanning can't be expressed in checked code. */
+static _Unchecked JSON_Status scan_quoted_string(const char **string : itype(_Ptr<_Nt_array_ptr<const char>>), const char **start : itype(_Ptr<_Nt_array_ptr<const char>>),
+                                                 _Ptr<size_t> string_len, _Ptr<size_t> output_len, _Ptr<int> has_escapes) {
+    const char *ptr = NULL;
+    size_t removed_len = 0; /* bytes removed by processing escapes */
+    unsigned int cp = 0;
+    if (**string != '\"') {
+        return JSONFailure;
     }
-    SKIP_WHITESPACES(string);
-    switch (**string) {
-        case '{':
-            return parse_object_value(string, nesting + 1);
-        case '[':
-            return parse_array_value(string, nesting + 1);
-        case '\"':
-            return parse_string_value(string);
-        case 'f': case 't':
-            return parse_boolean_value(string);
-        case '-':
-        case '0': case '1': case '2': case '3': case '4':
-        case '5': case '6': case '7': case '8': case '9':
-            return parse_number_value(string);
-        case 'n':
-            return parse_null_value(string);
-        default:
-            return NULL;
+    *start = *string + 1;
+    *has_escapes = 0;
+    ptr = scan_string(*start, NULL, '\"');
+    while (*ptr == '\\') {
+        *has_escapes = 1;
+        if (ptr[1] == 'u') {
+            if (!parse_utf16_hex(ptr + 2, &cp)) {
+                return JSONFailure;
+            }
+            if (cp < 0x80) {
+                removed_len += 5;
+            } else if (cp < 0x800) {
+                removed_len += 4;
+            } else if (cp < 0xD800 || cp > 0xDFFF) {
+                removed_len += 3;
+            } else if (cp <= 0xDBFF) {
+                removed_len += 2; /* lead surrogate, whole pair takes 4 bytes */
+            } else {
+                removed_len += 6; /* trail surrogate */
+            }
+            ptr = scan_string(ptr + 6, NULL, '\"');
+        } else if (ptr[1] == '\0') {
+            return JSONFailure;
+        } else {
+            removed_len += 1;
+            ptr = scan_string(ptr + 2, NULL, '\"');
+        }
+    }
+    if (*ptr != '\"') {
+        return JSONFailure; /* 0x00-0x19 are invalid characters for json string (http://www.ietf.org/rfc/rfc4627.txt) */
     }
+    *string_len = (size_t)(ptr - *start);
+    *output_len = *string_len - removed_len;
+    *string = ptr + 1;
+    return JSONSuccess;
 }
 
-static _Ptr<JSON_Value> parse_object_value(_Ptr<_Nt_array_ptr<const char>> string, size_t nesting) {
-    _Ptr<JSON_Value> output_value = NULL;
-    _Ptr<JSON_Value> new_value = NULL;
-    _Ptr<JSON_Object> output_object = NULL;
-    _Nt_array_ptr<char> new_key = NULL;
-    output_value = json_value_init_object();
-    if (output_value == NULL) {
-        return NULL;
+/* Return processed contents of a string between quotes and
+   skips passed argument to a matching quote. Result is allocated only once.
+   Strings of in-situ documents are processed in place and terminated where their
+   closing quote was. */
+/* Short strings are processed into short_buffer if it's given, unless they're parsed in-situ */
+static _Nt_array_ptr<char> get_quoted_string(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena, _Nt_array_ptr<char> short_buffer : count(SHORT_STRING_CAPACITY - 1)) {
+    size_t string_len = 0, output_len = 0;
+    int has_escapes = 0;
+    _Nt_array_ptr<const char> string_start : count(string_len) = NULL;
+    _Nt_array_ptr<char> output : count(output_len) = NULL;
+    // TODO: Bounds of the scanned string are only known after scanning.
+    _Unchecked {
+        const char *start = NULL;
+        size_t scanned_len = 0, processed_len = 0;
+        if (scan_quoted_string((const char**)string, &start, &scanned_len, &processed_len, &has_escapes) == JSONFailure) {
+            return NULL;
+        }
+        string_len = scanned_len;
+        output_len = processed_len;
+        string_start = _Assume_bounds_cast<_Nt_array_ptr<const char>>(start, count(string_len));
+    }
+    if (arena != NULL && arena->buffer != NULL) {
+        output = _Dynamic_bounds_cast<_Nt_array_ptr<char>>(json_arena_buffer_at(arena, string_start, string_len), count(output_len));
+    } else if (short_buffer != NULL && output_len < SHORT_STRING_CAPACITY) {
+        output = _Dynamic_bounds_cast<_Nt_array_ptr<char>>(short_buffer, count(output_len));
+    } else if (arena != NULL) {
+        output = json_arena_string_malloc(arena, output_len);
+    } else {
+        output = parson_string_malloc(output_len);
     }
-    if (**string != '{') {
-        json_value_free(output_value);
+    if (output == NULL) {
         return NULL;
     }
-    output_object = json_value_get_object(output_value);
-    SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
-    if (**string == '}') { /* empty object */
-        SKIP_CHAR(string);
-        return output_value;
+    if (!has_escapes) {
+        if (arena == NULL || arena->buffer == NULL) {
+            memcpy<char>(output, string_start, string_len);
+        }
+        output[output_len] = '\0';
+        return output;
     }
-    while (**string != '\0') {
-        new_key = get_quoted_string(string);
-        if (new_key == NULL) {
-            json_value_free(output_value);
-            return NULL;
+    if (unescape_string(string_start, string_len, output, output_len) == JSONFailure) {
+        if (arena == NULL && output != short_buffer) {
+            parson_free(char, output);
         }
-        SKIP_WHITESPACES(string);
-        if (**string != ':') {
-            parson_free(char, new_key);
-            json_value_free(output_value);
-            return NULL;
+        return NULL;
+    }
+    return output;
+}
+
+static JSON_Status json_parse_scratch_add(_Ptr<JSON_Parse_Scratch> scratch, _Nt_array_ptr<char> name : count(name_len), size_t name_len, JSON_Array_Cell cell) {
+    size_t new_capacity = 0;
+    _Array_ptr<JSON_Parse_Entry> new_entries : count(new_capacity) = NULL;
+    if (scratch->entries_count == scratch->entries_capacity) {
+        new_capacity = scratch->entries_capacity == 0 ? STARTING_CAPACITY : scratch->entries_capacity * 2;
+        new_entries = parson_malloc(JSON_Parse_Entry, new_capacity * sizeof(JSON_Parse_Entry));
+        if (new_entries == NULL) {
+            return JSONFailure;
         }
-        SKIP_CHAR(string);
-        new_value = parse_value(string, nesting);
-        if (new_value == NULL) {
-            parson_free(char, new_key);
-            json_value_free(output_value);
-            return NULL;
+        if (scratch->entries_count > 0) {
+            memcpy<JSON_Parse_Entry>(_Dynamic_bounds_cast<_Array_ptr<JSON_Parse_Entry>>(new_entries, count(scratch->entries_count)),
+                                     _Dynamic_bounds_cast<_Array_ptr<JSON_Parse_Entry>>(scratch->entries, count(scratch->entries_count)),
+                                     scratch->entries_count * sizeof(JSON_Parse_Entry));
         }
-        if (json_object_add(output_object, new_key, new_value) == JSONFailure) {
-            parson_free(char, new_key);
-            json_value_free(new_value);
-            json_value_free(output_value);
-            return NULL;
+        parson_free(JSON_Parse_Entry, scratch->entries);
+        // TODO: The two statements below need to be changed atomically
+        scratch->entries = new_entries;
+        scratch->entries_capacity = new_capacity;
+    }
+    // TODO: The two statements below need to be changed atomically
+    scratch->entries[scratch->entries_count].length = name_len;
+    scratch->entries[scratch->entries_count].name = name;
+    scratch->entries[scratch->entries_count].cell = cell;
+    scratch->entries_count++;
+    return JSONSuccess;
+}
+
+/* Opens the container added last */
+static JSON_Status json_parse_scratch_open(_Ptr<JSON_Parse_Scratch> scratch) {
+    size_t new_capacity = 0;
+    _Array_ptr<size_t> new_open : count(new_capacity) = NULL;
+    if (scratch->open_count == scratch->open_capacity) {
+        new_capacity = scratch->open_capacity == 0 ? STARTING_CAPACITY : scratch->open_capacity * 2;
+        new_open = parson_malloc(size_t, new_capacity * sizeof(size_t));
+        if (new_open == NULL) {
+            return JSONFailure;
         }
-        parson_free(char, new_key);
-        SKIP_WHITESPACES(string);
-        if (**string != ',') {
-            break;
+        if (scratch->open_count > 0) {
+            memcpy<size_t>(_Dynamic_bounds_cast<_Array_ptr<size_t>>(new_open, count(scratch->open_count)),
+                           _Dynamic_bounds_cast<_Array_ptr<size_t>>(scratch->open, count(scratch->open_count)),
+                           scratch->open_count * sizeof(size_t));
         }
-        SKIP_CHAR(string);
-        SKIP_WHITESPACES(string);
-    }
-    SKIP_WHITESPACES(string);
-    if (**string != '}' || /* Trim object after parsing is over */
-        json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure) {
-            json_value_free(output_value);
-            return NULL;
+        parson_free(size_t, scratch->open);
+        // TODO: The two statements below need to be changed atomically
+        scratch->open = new_open;
+        scratch->open_capacity = new_capacity;
     }
-    SKIP_CHAR(string);
-    return output_value;
+    scratch->open[scratch->open_count] = scratch->entries_count - 1;
+    scratch->open_count++;
+    return JSONSuccess;
 }
 
-static _Ptr<JSON_Value> parse_array_value(_Ptr<_Nt_array_ptr<const char>> string, size_t nesting) {
-    _Ptr<JSON_Value> output_value = NULL;
-    _Ptr<JSON_Value> new_array_value = NULL;
-    _Ptr<JSON_Array> output_array = NULL;
-    output_value = json_value_init_array();
-    if (output_value == NULL) {
-        return NULL;
-    }
-    if (**string != '[') {
-        json_value_free(output_value);
-        return NULL;
-    }
-    output_array = json_value_get_array(output_value);
-    SKIP_CHAR(string);
-    SKIP_WHITESPACES(string);
-    if (**string == ']') { /* empty array */
-        SKIP_CHAR(string);
-        return output_value;
-    }
-    while (**string != '\0') {
-        new_array_value = parse_value(string, nesting);
-        if (new_array_value == NULL) {
-            json_value_free(output_value);
-            return NULL;
+/* Moves children of the innermost open container into it. Its object or array is only allocated
+   now, with room for exactly as many children, so the container doesn't have to be grown or trimmed.
+   Up to PARSED_INLINE_CAPACITY children are kept inline, in the same allocation. Nulls, booleans
+   and numbers in arrays are unboxed cells until now, they become the values of the array. Arrays
+   that have nothing else are packed, without items. */
+static JSON_Status json_parse_scratch_close(_Ptr<JSON_Parse_Scratch> scratch, _Ptr<JSON_Arena> arena) {
+    size_t start = scratch->open[scratch->open_count - 1] + 1;
+    size_t count = scratch->entries_count - start;
+    size_t inline_capacity = count <= PARSED_INLINE_CAPACITY ? count : 0;
+    size_t index_capacity = OBJECT_INDEX_THRESHOLD * 2;
+    size_t values_count = 0, values_used = 0;
+    size_t i = 0;
+    _Ptr<JSON_Value> container = scratch->entries[start - 1].cell.value.boxed;
+    _Ptr<JSON_Array> array = NULL;
+    _Array_ptr<JSON_Value> values : count(values_count) = NULL;
+    _Ptr<JSON_Value> value = NULL;
+    _Ptr<JSON_Array_Cell> cell = NULL;
+    _Ptr<JSON_Object> object = NULL;
+    if (json_value_get_type(container) == JSONArray) {
+        for (i = start; i < scratch->entries_count; i++) {
+            values_count += scratch->entries[i].cell.type != ARRAY_CELL_BOXED;
         }
-        if (json_array_add(output_array, new_array_value) == JSONFailure) {
-            json_value_free(new_array_value);
-            json_value_free(output_value);
-            return NULL;
+        if (values_count == count) {
+            inline_capacity = 0;
+        }
+        array = json_array_init(container, arena, inline_capacity, values_count);
+        if (array == NULL) {
+            return JSONFailure;
+        }
+        container->value.array = array;
+        if (values_count < count && count > inline_capacity && json_array_resize(array, count) == JSONFailure) {
+            return JSONFailure;
+        }
+        values = json_array_values(array);
+        for (i = start; i < scratch->entries_count; i++) {
+            cell = &scratch->entries[i].cell;
+            if (cell->type == ARRAY_CELL_BOXED) {
+                value = cell->value.boxed;
+            } else {
+                value = &values[values_used++];
+                value->type = cell->type;
+                value->flags = cell->flags | VALUE_FLAG_PACKED | (arena != NULL ? VALUE_FLAG_ARENA : 0);
+                value->value = cell->value;
+            }
+            if (json_array_is_packed(array)) {
+                value->parent = container;
+                array->count++;
+            } else {
+                json_array_add(array, value); /* can't fail, there's room */
+            }
+        }
+    } else {
+        object = json_object_init(container, arena, inline_capacity);
+        if (object == NULL) {
+            return JSONFailure;
+        }
+        container->value.object = object;
+        if (count > inline_capacity && json_object_resize(object, count) == JSONFailure) {
+            return JSONFailure;
+        }
+        if (count >= OBJECT_INDEX_THRESHOLD) {
+            while (index_capacity < count * 2) {
+                index_capacity *= 2;
+            }
+            /* Failing to build the index only makes lookups slower, so it's not an error */
+            json_object_index_build(object, index_capacity);
+        }
+        for (i = start; i < scratch->entries_count; i++) {
+            if (json_object_addn_no_copy(object, scratch->entries[i].name, scratch->entries[i].length, scratch->entries[i].cell.value.boxed) == JSONFailure) {
+                object->count = 0; /* names and values are still owned by scratch */
+                return JSONFailure;
+            }
+        }
+    }
+    scratch->entries_count = start;
+    scratch->open_count--;
+    return JSONSuccess;
+}
+
+/* Frees a parsed value that isn't in a container yet. Containers that weren't closed have no object or array. */
+static void json_parse_cell_free(_Ptr<JSON_Array_Cell> cell, _Ptr<JSON_Arena> arena) {
+    _Ptr<JSON_Value> value = cell->type == ARRAY_CELL_BOXED ? cell->value.boxed : NULL;
+    if ((json_value_get_type(value) == JSONObject && value->value.object == NULL) ||
+        (json_value_get_type(value) == JSONArray && value->value.array == NULL)) {
+        parson_arena_free(arena, JSON_Value, value);
+        return;
+    }
+    json_value_free(value);
+}
+
+static void json_parse_scratch_free(_Ptr<JSON_Parse_Scratch> scratch, _Ptr<JSON_Arena> arena) {
+    size_t i;
+    for (i = 0; i < scratch->entries_count; i++) {
+        if (scratch->entries[i].name != NULL) {
+            parson_arena_free(arena, char, scratch->entries[i].name);
+        }
+        json_parse_cell_free(&scratch->entries[i].cell, arena);
+    }
+    parson_free(JSON_Parse_Entry, scratch->entries);
+    parson_free(size_t, scratch->open);
+}
+
+/* Parses a value without recursing into arrays and objects. Values in containers that are still
+   open are collected in scratch, which is only allocated once a container starts. Scalars are
+   parsed into cells, which are boxed unless they go into an array. */
+static _Ptr<JSON_Value> parse_value(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena) {
+    JSON_Parse_Scratch scratch = { NULL, 0, 0, NULL, 0, 0 };
+    JSON_Array_Cell cell = { ARRAY_CELL_BOXED, 0, { NULL } };
+    _Ptr<JSON_Value> value = NULL;
+    _Nt_array_ptr<char> name = NULL;
+    size_t name_len = 0;
+    _Nt_array_ptr<char> name_with_len : count(name_len) = NULL;
+    JSON_Value_Type type = JSONError;
+    int failed = 0;
+    for (;;) {
+        type = scratch.open_count > 0 ? json_value_get_type(scratch.entries[scratch.open[scratch.open_count - 1]].cell.value.boxed) : JSONError;
+        if (type == JSONObject) {
+            name = get_quoted_string(string, arena, NULL);
+            if (name == NULL) {
+                break;
+            }
+            SKIP_WHITESPACES(string);
+            if (**string != ':') {
+                break;
+            }
+            SKIP_CHAR(string);
+        }
+        if (scratch.open_count > parson_max_nesting) {
+            break;
         }
         SKIP_WHITESPACES(string);
-        if (**string != ',') {
+        cell.type = ARRAY_CELL_BOXED;
+        cell.flags = 0;
+        cell.value.boxed = NULL;
+        switch (**string) {
+            case '{':
+                cell.value.boxed = json_value_alloc(arena, JSONObject);
+                if (cell.value.boxed != NULL) {
+                    cell.value.boxed->value.object = NULL; /* allocated when it's closed */
+                }
+                break;
+            case '[':
+                cell.value.boxed = json_value_alloc(arena, JSONArray);
+                if (cell.value.boxed != NULL) {
+                    cell.value.boxed->value.array = NULL; /* allocated when it's closed */
+                }
+                break;
+            default:
+                parse_scalar_cell(string, arena, &cell);
+                break;
+        }
+        if (cell.type != ARRAY_CELL_BOXED && type != JSONArray) {
+            cell.value.boxed = json_value_init_cell(arena, &cell);
+            cell.type = ARRAY_CELL_BOXED;
+            cell.flags = 0;
+        }
+        if (cell.type == ARRAY_CELL_BOXED && cell.value.boxed == NULL) {
             break;
         }
+        type = cell.type == ARRAY_CELL_BOXED ? json_value_get_type(cell.value.boxed) : cell.type;
+        if (scratch.open_count == 0 && type != JSONObject && type != JSONArray) {
+            return cell.value.boxed;
+        }
+        name_len = name != NULL ? strlen(name) : 0;
+        _Unchecked {
+            name_with_len = _Assume_bounds_cast<_Nt_array_ptr<char>>(name, count(name_len));
+        }
+        if (json_parse_scratch_add(&scratch, name_with_len, name_len, cell) == JSONFailure) {
+            json_parse_cell_free(&cell, arena);
+            break;
+        }
+        name = NULL;
+        if (type == JSONObject || type == JSONArray) {
+            if (json_parse_scratch_open(&scratch) == JSONFailure) {
+                break;
+            }
+            SKIP_CHAR(string);
+            SKIP_WHITESPACES(string);
+            if (**string != (type == JSONObject ? '}' : ']')) {
+                continue;
+            }
+            /* empty container is closed below */
+        }
+        /* Closes every container that ends after this value */
+        while (scratch.open_count > 0) {
+            type = json_value_get_type(scratch.entries[scratch.open[scratch.open_count - 1]].cell.value.boxed);
+            SKIP_WHITESPACES(string);
+            if (**string == ',') {
+                break;
+            }
+            if (**string != (type == JSONObject ? '}' : ']') || json_parse_scratch_close(&scratch, arena) == JSONFailure) {
+                failed = 1;
+                break;
+            }
+            SKIP_CHAR(string);
+        }
+        if (failed) {
+            break;
+        }
+        if (scratch.open_count == 0) {
+            value = scratch.entries[0].cell.value.boxed;
+            scratch.entries_count = 0;
+            json_parse_scratch_free(&scratch, arena);
+            return value;
+        }
         SKIP_CHAR(string);
         SKIP_WHITESPACES(string);
     }
-    SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure) {
-            json_value_free(output_value);
-            return NULL;
+    if (name != NULL) {
+        parson_arena_free(arena, char, name);
     }
-    SKIP_CHAR(string);
-    return output_value;
+    json_parse_scratch_free(&scratch, arena);
+    return NULL;
 }
 
-static _Ptr<JSON_Value> parse_string_value(_Ptr<_Nt_array_ptr<const char>> string) {
-    _Ptr<JSON_Value> value = NULL;
-    _Nt_array_ptr<char> new_string = get_quoted_string(string);
-    if (new_string == NULL) {
-        return NULL;
+/* Parses a string, boolean, number or null into cell, only strings are boxed */
+static JSON_Status parse_scalar_cell(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena, _Ptr<JSON_Array_Cell> cell) {
+    switch (**string) {
+        case '\"':
+            cell->value.boxed = parse_string_value(string, arena);
+            return cell->value.boxed != NULL ? JSONSuccess : JSONFailure;
+        case 'f': case 't':
+            return parse_boolean_cell(string, cell);
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return parse_number_cell(string, cell);
+        case 'n':
+            return parse_null_cell(string, cell);
+        default:
+            return JSONFailure;
     }
-    value = json_value_init_string_no_copy(new_string);
+}
+
+static _Ptr<JSON_Value> parse_string_value(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Arena> arena) {
+    _Ptr<JSON_Value> value = json_value_alloc(arena, JSONString);
+    _Nt_array_ptr<char> new_string = NULL;
     if (value == NULL) {
-        parson_free(char, new_string);
         return NULL;
     }
+    new_string = get_quoted_string(string, arena, value->value.short_string);
+    if (new_string == NULL) {
+        parson_arena_free(arena, JSON_Value, value);
+        return NULL;
+    }
+    if (new_string == value->value.short_string) {
+        value->flags |= VALUE_FLAG_SHORT_STRING;
+    } else {
+        value->value.string = new_string;
+    }
     return value;
 }
 
-static _Ptr<JSON_Value> parse_boolean_value(_Ptr<_Nt_array_ptr<const char>> string) {
+static JSON_Status parse_boolean_cell(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Array_Cell> cell) {
     size_t true_token_size = SIZEOF_TOKEN("true");
     size_t false_token_size = SIZEOF_TOKEN("false");
     if (strncmp("true", *string, true_token_size) == 0) {
         *string += true_token_size;
-        return json_value_init_boolean(1);
+        cell->value.boolean = 1;
     } else if (strncmp("false", *string, false_token_size) == 0) {
         *string += false_token_size;
-        return json_value_init_boolean(0);
+        cell->value.boolean = 0;
+    } else {
+        return JSONFailure;
     }
-    return NULL;
+    cell->type = JSONBoolean;
+    return JSONSuccess;
 }
 
-/* TODO: The way this function deals with end is not well supported by the compiler. 
- * No initialization, needing to take the address, weird counting.
- * Leaving this function unchecked for now as a result. */
-static _Unchecked _Ptr<JSON_Value> parse_number_value(const char** string) {
-    char* end = NULL;
-    double number = 0;
-    errno = 0;
-    number = strtod(*string, &end);
-    if (errno || !is_decimal(*string, (size_t)(end - *string))) {
-        return NULL;
+static JSON_Status parse_number_cell(const char** string : itype(_Ptr<_Nt_array_ptr<const char>>), _Ptr<JSON_Array_Cell> cell) {
+    JSON_Value_Value number = { NULL };
+    int flags = 0;
+    if (parse_number(string, &number, &flags) == JSONFailure) {
+        return JSONFailure;
     }
-    *string = end;
-    return json_value_init_number(number);
+    cell->type = JSONNumber;
+    cell->flags = flags;
+    cell->value = number;
+    return JSONSuccess;
 }
 
-static _Ptr<JSON_Value> parse_null_value(_Ptr<_Nt_array_ptr<const char>> string) {
+static JSON_Status parse_null_cell(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Array_Cell> cell) {
     size_t token_size = SIZEOF_TOKEN("null");
-    if (strncmp("null", *string, token_size) == 0) {
-        *string += token_size;
-        return json_value_init_null();
+    if (strncmp("null", *string, token_size) != 0) {
+        return JSONFailure;
     }
-    return NULL;
+    *string += token_size;
+    cell->type = JSONNull;
+    return JSONSuccess;
+}
+
+/* Push parser */
+/* Type of the innermost open container, JSONError if there's none */
+static JSON_Value_Type json_parser_container_type(_Ptr<JSON_Parser> parser) {
+    _Ptr<JSON_Parse_Scratch> scratch = &parser->scratch;
+    if (scratch->open_count == 0) {
+        return JSONError;
+    }
+    return json_value_get_type(scratch->entries[scratch->open[scratch->open_count - 1]].cell.value.boxed);
+}
+
+static JSON_Status json_parser_add_value(_Ptr<JSON_Parser> parser, _Ptr<JSON_Value> value) {
+    JSON_Array_Cell cell = { ARRAY_CELL_BOXED, 0, { NULL } };
+    cell.value.boxed = value;
+    return json_parser_add_cell(parser, cell);
+}
+
+/* Adds a complete scalar or a just started container to the innermost open container, containers
+   get their object or array when they close, like in parse_value. Scalars are boxed unless they go
+   into an array. Cell is freed if it can't be added. */
+static JSON_Status json_parser_add_cell(_Ptr<JSON_Parser> parser, JSON_Array_Cell cell) {
+    _Ptr<JSON_Parse_Scratch> scratch = &parser->scratch;
+    size_t name_len = 0;
+    _Nt_array_ptr<char> name : count(name_len) = NULL;
+    JSON_Value_Type type = JSONError;
+    if (scratch->open_count > parson_max_nesting) {
+        json_parse_cell_free(&cell, NULL);
+        return JSONFailure;
+    }
+    if (cell.type != ARRAY_CELL_BOXED && json_parser_container_type(parser) != JSONArray) {
+        cell.value.boxed = json_value_init_cell(NULL, &cell);
+        if (cell.value.boxed == NULL) {
+            return JSONFailure;
+        }
+        cell.type = ARRAY_CELL_BOXED;
+        cell.flags = 0;
+    }
+    type = cell.type == ARRAY_CELL_BOXED ? json_value_get_type(cell.value.boxed) : cell.type;
+    if (scratch->open_count == 0 && type != JSONArray && type != JSONObject) {
+        parser->root = cell.value.boxed;
+        parser->state = PARSER_STATE_DONE;
+        return JSONSuccess;
+    }
+    if (json_parser_container_type(parser) == JSONObject) {
+        name_len = strlen(parser->name);
+        _Unchecked {
+            name = _Assume_bounds_cast<_Nt_array_ptr<char>>(parser->name, count(name_len));
+        }
+    }
+    if (json_parse_scratch_add(scratch, name, name_len, cell) == JSONFailure) {
+        json_parse_cell_free(&cell, NULL); /* name is freed with the parser */
+        return JSONFailure;
+    }
+    parser->name = NULL;
+    if (type == JSONArray || type == JSONObject) {
+        if (json_parse_scratch_open(scratch) == JSONFailure) {
+            return JSONFailure; /* value is already owned by scratch */
+        }
+        parser->state = type == JSONArray ? PARSER_STATE_VALUE_OR_END : PARSER_STATE_NAME_OR_END;
+    } else {
+        parser->state = PARSER_STATE_COMMA_OR_END;
+    }
+    return JSONSuccess;
+}
+
+/* Moves children of the innermost container into it, which is allocated at its exact size */
+static JSON_Status json_parser_close(_Ptr<JSON_Parser> parser, char c) {
+    _Ptr<JSON_Parse_Scratch> scratch = &parser->scratch;
+    if ((c == ']') != (json_parser_container_type(parser) == JSONArray)) {
+        return JSONFailure;
+    }
+    if (json_parse_scratch_close(scratch, NULL) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (scratch->open_count > 0) {
+        parser->state = PARSER_STATE_COMMA_OR_END;
+        return JSONSuccess;
+    }
+    parser->root = scratch->entries[0].cell.value.boxed;
+    scratch->entries_count = 0;
+    parser->state = PARSER_STATE_DONE;
+    return JSONSuccess;
+}
+
+/* Buffered string token ends with a quote, which closes it unless it's escaped.
+   TODO: Looking back from the end of the token isn't expressible with checked pointers. */
+static _Unchecked int json_parser_string_is_complete(_Ptr<JSON_Parser> parser) {
+    size_t i = parser->token.length - 1;
+    size_t backslashes = 0;
+    while (i > 1 && parser->token.buf[i - 1] == '\\') { /* token.buf[0] is the opening quote */
+        backslashes++;
+        i--;
+    }
+    return backslashes % 2 == 0;
+}
+
+/* Parses a complete string, number or literal with the same functions as the recursive parser.
+   Token has to be consumed whole, unless it's the root value, which like in json_parse_string ends
+   where its parsing stops, e.g. "trueu" is true followed by ignored input. Token is either null
+   terminated in the token buffer or followed by a delimiter in the chunk, which stops the parsing
+   functions just as well.
+   TODO: The token isn't null terminated in the chunk, so it can't be checked. */
+static _Unchecked JSON_Status json_parser_add_token(_Ptr<JSON_Parser> parser, const char *token, const char *token_end) {
+    const char *string = token;
+    JSON_Array_Cell cell = { ARRAY_CELL_BOXED, 0, { NULL } };
+    parser->token_type = PARSER_TOKEN_NONE;
+    if (parser->state == PARSER_STATE_NAME || parser->state == PARSER_STATE_NAME_OR_END) {
+        parser->name = get_quoted_string((_Ptr<_Nt_array_ptr<const char>>)&string, NULL, NULL);
+        if (parser->name == NULL) {
+            return JSONFailure;
+        }
+        parser->state = PARSER_STATE_COLON;
+        return JSONSuccess;
+    }
+    if (parse_scalar_cell((_Ptr<_Nt_array_ptr<const char>>)&string, NULL, &cell) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (string != token_end && parser->scratch.open_count > 0) {
+        json_parse_cell_free(&cell, NULL);
+        return JSONFailure;
+    }
+    return json_parser_add_cell(parser, cell);
+}
+
+/* TODO: Token buffer is bounded by its capacity, not by its length. */
+static _Unchecked JSON_Status json_parser_end_token(_Ptr<JSON_Parser> parser) {
+    if (writer_finish(&parser->token) == JSONFailure) {
+        return JSONFailure;
+    }
+    return json_parser_add_token(parser, parser->token.buf, parser->token.buf + parser->token.length);
+}
+
+/* Consumes a chunk. Structural characters are handled right away, strings, numbers and literals
+   are collected in token until they end, which may take several chunks. Comments are skipped
+   without being collected.
+   TODO: Scanning the chunk by pointer isn't expressible with checked pointers. */
+static _Unchecked JSON_Status json_parser_scan(_Ptr<JSON_Parser> parser, const char *chunk : itype(_Array_ptr<const char>) count(len), size_t len) {
+    const char *ptr = chunk;
+    const char *end = chunk + len;
+    const char *token_end = NULL;
+    JSON_Value *container = NULL;
+    int expects_value = 0;
+    while (ptr < end && parser->bom_matched >= 0 && parser->bom_matched < 3) { /* Support for UTF-8 BOM */
+        if (*ptr != "\xEF\xBB\xBF"[parser->bom_matched]) {
+            if (parser->bom_matched > 0) {
+                return JSONFailure;
+            }
+            parser->bom_matched = -1;
+            break;
+        }
+        parser->bom_matched++;
+        ptr++;
+    }
+    while (ptr < end && parser->state != PARSER_STATE_DONE) {
+        if (parser->token_type == PARSER_TOKEN_STRING) {
+            token_end = (const char*)memchr(ptr, '\"', (size_t)(end - ptr));
+            token_end = token_end != NULL ? token_end + 1 : end;
+            if (writer_append(&parser->token, ptr, (size_t)(token_end - ptr)) == JSONFailure) {
+                return JSONFailure;
+            }
+            if (token_end[-1] == '\"' && json_parser_string_is_complete(parser) &&
+                json_parser_end_token(parser) == JSONFailure) {
+                return JSONFailure;
+            }
+            ptr = token_end;
+            continue;
+        }
+        if (parser->token_type == PARSER_TOKEN_COMMENT_START) {
+            if (*ptr != '/' && *ptr != '*') {
+                return JSONFailure;
+            }
+            parser->token_type = *ptr == '/' ? PARSER_TOKEN_LINE_COMMENT : PARSER_TOKEN_BLOCK_COMMENT;
+            ptr++;
+            continue;
+        }
+        if (parser->token_type == PARSER_TOKEN_LINE_COMMENT) {
+            token_end = (const char*)memchr(ptr, '\n', (size_t)(end - ptr));
+            if (token_end != NULL) {
+                parser->token_type = PARSER_TOKEN_NONE;
+            }
+            ptr = token_end != NULL ? token_end + 1 : end;
+            continue;
+        }
+        if (parser->token_type == PARSER_TOKEN_BLOCK_COMMENT || parser->token_type == PARSER_TOKEN_BLOCK_COMMENT_STAR) {
+            while (ptr < end && parser->token_type != PARSER_TOKEN_NONE) {
+                if (*ptr == '/' && parser->token_type == PARSER_TOKEN_BLOCK_COMMENT_STAR) {
+                    parser->token_type = PARSER_TOKEN_NONE;
+                } else {
+                    parser->token_type = *ptr == '*' ? PARSER_TOKEN_BLOCK_COMMENT_STAR : PARSER_TOKEN_BLOCK_COMMENT;
+                }
+                ptr++;
+            }
+            continue;
+        }
+        if (parser->token_type != PARSER_TOKEN_NONE) {
+            token_end = ptr;
+            if (parser->token_type == PARSER_TOKEN_NUMBER) {
+                while (token_end < end && IS_NUMBER_CHAR(*token_end)) {
+                    token_end++;
+                }
+            } else {
+                while (token_end < end && *token_end >= 'a' && *token_end <= 'z') {
+                    token_end++;
+                }
+            }
+            if (token_end < end && parser->token.length == 0) { /* whole token is in the chunk */
+                if (json_parser_add_token(parser, ptr, token_end) == JSONFailure) {
+                    return JSONFailure;
+                }
+                ptr = token_end;
+                continue;
+            }
+            if (writer_append(&parser->token, ptr, (size_t)(token_end - ptr)) == JSONFailure) {
+                return JSONFailure;
+            }
+            if (token_end < end && json_parser_end_token(parser) == JSONFailure) {
+                return JSONFailure;
+            }
+            ptr = token_end;
+            continue;
+        }
+        expects_value = parser->state == PARSER_STATE_VALUE || parser->state == PARSER_STATE_VALUE_OR_END;
+        switch (*ptr) {
+            case ' ': case '\n': case '\r': case '\t':
+                while (ptr + 1 < end && IS_WHITESPACE(ptr[1])) {
+                    ptr++;
+                }
+                break;
+            case '{': case '[':
+                if (!expects_value) {
+                    return JSONFailure;
+                }
+                container = json_value_alloc(NULL, *ptr == '{' ? JSONObject : JSONArray);
+                if (container == NULL) {
+                    return JSONFailure;
+                }
+                if (*ptr == '{') {
+                    container->value.object = NULL; /* allocated when it's closed */
+                } else {
+                    container->value.array = NULL;
+                }
+                if (json_parser_add_value(parser, container) == JSONFailure) {
+                    return JSONFailure;
+                }
+                break;
+            case '}': case ']':
+                if (parser->state != PARSER_STATE_COMMA_OR_END &&
+                    !(*ptr == ']' && parser->state == PARSER_STATE_VALUE_OR_END) &&
+                    !(*ptr == '}' && parser->state == PARSER_STATE_NAME_OR_END)) {
+                    return JSONFailure;
+                }
+                if (json_parser_close(parser, *ptr) == JSONFailure) {
+                    return JSONFailure;
+                }
+                break;
+            case ',':
+                if (parser->state != PARSER_STATE_COMMA_OR_END) {
+                    return JSONFailure;
+                }
+                parser->state = json_parser_container_type(parser) == JSONArray ? PARSER_STATE_VALUE : PARSER_STATE_NAME;
+                break;
+            case ':':
+                if (parser->state != PARSER_STATE_COLON) {
+                    return JSONFailure;
+                }
+                parser->state = PARSER_STATE_VALUE;
+                break;
+            case '\"':
+                if (!expects_value && parser->state != PARSER_STATE_NAME && parser->state != PARSER_STATE_NAME_OR_END) {
+                    return JSONFailure;
+                }
+                token_end = (const char*)memchr(ptr + 1, '\"', (size_t)(end - ptr - 1));
+                if (token_end != NULL && memchr(ptr + 1, '\\', (size_t)(token_end - ptr - 1)) == NULL) {
+                    /* whole string is in the chunk and its end can't be escaped */
+                    if (json_parser_add_token(parser, ptr, token_end + 1) == JSONFailure) {
+                        return JSONFailure;
+                    }
+                    ptr = token_end + 1;
+                    continue;
+                }
+                parser->token_type = PARSER_TOKEN_STRING;
+                parser->token.length = 0;
+                if (writer_append(&parser->token, ptr, 1) == JSONFailure) {
+                    return JSONFailure;
+                }
+                break;
+            case '-':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+            case 't': case 'f': case 'n':
+                if (!expects_value) {
+                    return JSONFailure;
+                }
+                parser->token_type = *ptr >= 'a' && *ptr <= 'z' ? PARSER_TOKEN_LITERAL : PARSER_TOKEN_NUMBER;
+                parser->token.length = 0;
+                continue; /* first character is collected with the rest of the token */
+            case '/':
+                if (!parser->allow_comments) {
+                    return JSONFailure;
+                }
+                parser->token_type = PARSER_TOKEN_COMMENT_START;
+                break;
+            default:
+                return JSONFailure;
+        }
+        ptr++;
+    }
+    return JSONSuccess;
+}
+
+static _Ptr<JSON_Parser> json_parser_init_internal(int allow_comments) {
+    _Ptr<JSON_Parser> parser = parson_malloc(JSON_Parser, sizeof(JSON_Parser));
+    if (parser == NULL) {
+        return NULL;
+    }
+    memset<JSON_Parser>(parser, 0, sizeof(JSON_Parser));
+    parser->token.buf = parson_malloc(char, PARSER_STARTING_TOKEN_CAPACITY);
+    if (parser->token.buf == NULL) {
+        json_parser_free(parser);
+        return NULL;
+    }
+    parser->token.capacity = PARSER_STARTING_TOKEN_CAPACITY;
+    parser->token.growable = 1;
+    parser->state = PARSER_STATE_VALUE;
+    parser->allow_comments = allow_comments;
+    return parser;
+}
+
+static void json_parser_free(_Ptr<JSON_Parser> parser) {
+    if (parser->root != NULL) {
+        json_value_free(parser->root);
+    }
+    if (parser->name != NULL) {
+        parson_free(char, parser->name);
+    }
+    json_parse_scratch_free(&parser->scratch, NULL);
+    parson_free(char, parser->token.buf);
+    parson_free(JSON_Parser, parser);
+}
+
+/* Buffers are fed to a push parser at once, it doesn't need a null terminator */
+static _Ptr<JSON_Value> json_parse_buffer_internal(_Array_ptr<const char> buf : count(len), size_t len, int allow_comments) {
+    _Ptr<JSON_Parser> parser = NULL;
+    if (buf == NULL) {
+        return NULL;
+    }
+    parser = json_parser_init_internal(allow_comments);
+    if (parser == NULL) {
+        return NULL;
+    }
+    json_parser_feed(parser, buf, len); /* failure is reported by finish */
+    return json_parser_finish(parser);
+}
+
+/* Event parser, follows the same grammar as the recursive parser */
+#define SAX_EVENT(state, event) ((state)->callbacks->event != NULL ? (state)->callbacks->event((state)->context) : JSONSuccess)
+
+/* Strings without escapes are reported in place, others are unescaped into the reused buffer.
+   TODO: Buffer is reallocated with its bounds, which the compiler can't follow. */
+static _Unchecked JSON_Status sax_parse_string(const char **string : itype(_Ptr<_Nt_array_ptr<const char>>), _Ptr<JSON_Sax_State> state, int is_key) {
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>), const char *string : itype(_Array_ptr<const char>) count(len), size_t len)> callback =
+        is_key ? state->callbacks->key : state->callbacks->string;
+    const char *start = NULL;
+    char *new_buffer = NULL;
+    size_t string_len = 0, output_len = 0;
+    int has_escapes = 0;
+    if (scan_quoted_string(string, &start, &string_len, &output_len, &has_escapes) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (has_escapes) {
+        if (output_len > state->buffer_capacity) {
+            new_buffer = (char*)parson_malloc(char, output_len + 1);
+            if (new_buffer == NULL) {
+                return JSONFailure;
+            }
+            parson_free(char, state->buffer);
+            state->buffer = new_buffer;
+            state->buffer_capacity = output_len;
+        }
+        if (unescape_string(_Assume_bounds_cast<_Nt_array_ptr<const char>>(start, count(string_len)), string_len,
+                            _Assume_bounds_cast<_Nt_array_ptr<char>>(state->buffer, count(output_len)), output_len) == JSONFailure) {
+            return JSONFailure;
+        }
+        start = state->buffer;
+    }
+    return callback != NULL ? callback(state->context, start, output_len) : JSONSuccess;
+}
+
+static JSON_Status sax_parse_scalar(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Sax_State> state) {
+    JSON_Value_Value number = { NULL };
+    int flags = 0;
+    switch (**string) {
+        case '\"':
+            return sax_parse_string(string, state, 0);
+        case 'f': case 't':
+            if (strncmp("true", *string, SIZEOF_TOKEN("true")) == 0) {
+                *string += SIZEOF_TOKEN("true");
+                return state->callbacks->boolean != NULL ? state->callbacks->boolean(state->context, 1) : JSONSuccess;
+            }
+            if (strncmp("false", *string, SIZEOF_TOKEN("false")) == 0) {
+                *string += SIZEOF_TOKEN("false");
+                return state->callbacks->boolean != NULL ? state->callbacks->boolean(state->context, 0) : JSONSuccess;
+            }
+            return JSONFailure;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            if (parse_number(string, &number, &flags) == JSONFailure) {
+                return JSONFailure;
+            }
+            if (state->callbacks->number == NULL) {
+                return JSONSuccess;
+            }
+            if (flags & VALUE_FLAG_INT64) {
+                return state->callbacks->number(state->context, (double)number.integer);
+            }
+            if (flags & VALUE_FLAG_UINT64) {
+                return state->callbacks->number(state->context, (double)number.uinteger);
+            }
+            return state->callbacks->number(state->context, number.number);
+        case 'n':
+            if (strncmp("null", *string, SIZEOF_TOKEN("null")) != 0) {
+                return JSONFailure;
+            }
+            *string += SIZEOF_TOKEN("null");
+            return SAX_EVENT(state, null);
+        default:
+            return JSONFailure;
+    }
+}
+
+/* Reports a value and everything in it without recursing, like parse_value.
+   Closing characters of open containers are kept in state->containers. */
+static JSON_Status sax_parse_value(_Ptr<_Nt_array_ptr<const char>> string, _Ptr<JSON_Sax_State> state) {
+    _Ptr<JSON_Writer> containers = &state->containers;
+    char end = '\0';
+    for (;;) {
+        if (containers->length > 0 && containers->buf[containers->length - 1] == '}') {
+            if (sax_parse_string(string, state, 1) == JSONFailure) {
+                return JSONFailure;
+            }
+            SKIP_WHITESPACES(string);
+            if (**string != ':') {
+                return JSONFailure;
+            }
+            SKIP_CHAR(string);
+        }
+        if (containers->length > parson_max_nesting) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        if (**string == '{' || **string == '[') {
+            end = **string == '{' ? '}' : ']';
+            SKIP_CHAR(string);
+            if ((end == '}' ? SAX_EVENT(state, start_object) : SAX_EVENT(state, start_array)) == JSONFailure) {
+                return JSONFailure;
+            }
+            SKIP_WHITESPACES(string);
+            if (**string != end) {
+                if (writer_append(containers, &end, 1) == JSONFailure) {
+                    return JSONFailure;
+                }
+                continue;
+            }
+            SKIP_CHAR(string); /* empty container */
+            if ((end == '}' ? SAX_EVENT(state, end_object) : SAX_EVENT(state, end_array)) == JSONFailure) {
+                return JSONFailure;
+            }
+        } else if (sax_parse_scalar(string, state) == JSONFailure) {
+            return JSONFailure;
+        }
+        /* Closes every container that ends after this value */
+        while (containers->length > 0) {
+            end = containers->buf[containers->length - 1];
+            SKIP_WHITESPACES(string);
+            if (**string == ',') {
+                break;
+            }
+            if (**string != end) {
+                return JSONFailure;
+            }
+            SKIP_CHAR(string);
+            containers->length--;
+            if ((end == '}' ? SAX_EVENT(state, end_object) : SAX_EVENT(state, end_array)) == JSONFailure) {
+                return JSONFailure;
+            }
+        }
+        if (containers->length == 0) {
+            return JSONSuccess;
+        }
+        SKIP_CHAR(string);
+        SKIP_WHITESPACES(string);
+    }
+}
+#undef SAX_EVENT
+
+/* Lazy document */
+static JSON_Status json_tape_push(_Ptr<JSON_Document> document, size_t offset) {
+    size_t new_capacity = 0;
+    _Array_ptr<JSON_Tape_Entry> new_tape : count(new_capacity) = NULL;
+    if (document->tape_count == document->tape_capacity) {
+        new_capacity = document->tape_capacity * 2;
+        new_tape = parson_malloc(JSON_Tape_Entry, new_capacity * sizeof(JSON_Tape_Entry));
+        if (new_tape == NULL) {
+            return JSONFailure;
+        }
+        memcpy<JSON_Tape_Entry>(_Dynamic_bounds_cast<_Array_ptr<JSON_Tape_Entry>>(new_tape, count(document->tape_count)),
+                                _Dynamic_bounds_cast<_Array_ptr<JSON_Tape_Entry>>(document->tape, count(document->tape_count)),
+                                document->tape_count * sizeof(JSON_Tape_Entry));
+        parson_free(JSON_Tape_Entry, document->tape);
+        // TODO: The two statements below need to be changed atomically
+        document->tape = new_tape;
+        document->tape_capacity = new_capacity;
+    }
+    document->tape[document->tape_count].offset = offset;
+    document->tape[document->tape_count].next = document->tape_count + 1;
+    document->tape[document->tape_count].value = NULL;
+    document->tape_count++;
+    return JSONSuccess;
+}
+
+/* TODO: Scanning can't be expressed in checked code. */
+static _Unchecked JSON_Status json_tape_skip_string(const char **string : itype(_Ptr<_Nt_array_ptr<const char>>)) {
+    const char *start = NULL;
+    size_t string_len = 0, output_len = 0;
+    int has_escapes = 0;
+    return scan_quoted_string(string, &start, &string_len, &output_len, &has_escapes);
+}
+
+static JSON_Status json_tape_skip_literal(_Ptr<_Nt_array_ptr<const char>> string, _Nt_array_ptr<const char> literal) {
+    size_t literal_len = strlen(literal);
+    if (strncmp(literal, *string, literal_len) != 0) {
+        return JSONFailure;
+    }
+    *string += literal_len;
+    return JSONSuccess;
+}
+
+static JSON_Status json_tape_skip_scalar(_Ptr<_Nt_array_ptr<const char>> string) {
+    switch (**string) {
+        case '\"':
+            return json_tape_skip_string(string);
+        case 't':
+            return json_tape_skip_literal(string, "true");
+        case 'f':
+            return json_tape_skip_literal(string, "false");
+        case 'n':
+            return json_tape_skip_literal(string, "null");
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            while (IS_NUMBER_CHAR(**string)) {
+                SKIP_CHAR(string);
+            }
+            return JSONSuccess;
+        default:
+            return JSONFailure;
+    }
+}
+
+/* Records value and everything in it, only structure is validated here.
+   Numbers are skipped by their characters and checked when they're decoded.
+   Containers aren't recursed into. While a container is open, its next field holds the tape
+   index of the enclosing open container, and it's set to the index after it when it closes. */
+static JSON_Status json_tape_build_value(_Ptr<JSON_Document> document, _Ptr<_Nt_array_ptr<const char>> string) {
+    size_t open = TAPE_NO_CONTAINER; /* innermost open container */
+    size_t depth = 0;
+    size_t index = 0;
+    char end = '\0';
+    for (;;) {
+        if (open != TAPE_NO_CONTAINER && document->string[document->tape[open].offset] == '{') {
+            if (json_tape_push(document, (size_t)(*string - document->string)) == JSONFailure ||
+                json_tape_skip_string(string) == JSONFailure) {
+                return JSONFailure;
+            }
+            SKIP_WHITESPACES(string);
+            if (**string != ':') {
+                return JSONFailure;
+            }
+            SKIP_CHAR(string);
+        }
+        if (depth > parson_max_nesting) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        index = document->tape_count;
+        if (json_tape_push(document, (size_t)(*string - document->string)) == JSONFailure) {
+            return JSONFailure;
+        }
+        if (**string == '{' || **string == '[') {
+            end = **string == '{' ? '}' : ']';
+            SKIP_CHAR(string);
+            SKIP_WHITESPACES(string);
+            if (**string != end) {
+                document->tape[index].next = open;
+                open = index;
+                depth++;
+                continue;
+            }
+            SKIP_CHAR(string); /* empty container */
+        } else if (json_tape_skip_scalar(string) == JSONFailure) {
+            return JSONFailure;
+        }
+        /* Closes every container that ends after this value */
+        while (open != TAPE_NO_CONTAINER) {
+            end = document->string[document->tape[open].offset] == '{' ? '}' : ']';
+            SKIP_WHITESPACES(string);
+            if (**string == ',') {
+                break;
+            }
+            if (**string != end) {
+                return JSONFailure;
+            }
+            SKIP_CHAR(string);
+            index = open;
+            open = document->tape[index].next;
+            document->tape[index].next = document->tape_count;
+            depth--;
+        }
+        if (open == TAPE_NO_CONTAINER) {
+            return JSONSuccess;
+        }
+        SKIP_CHAR(string);
+        SKIP_WHITESPACES(string);
+    }
+}
+
+/* Names without escapes are compared in place, others have to be processed first.
+   TODO: Scanning can't be expressed in checked code. */
+static _Unchecked int json_document_name_equals(_Ptr<const JSON_Document> document, size_t index, const char *name : itype(_Nt_array_ptr<const char>) count(name_len), size_t name_len) {
+    const char *string = document->string + document->tape[index].offset;
+    const char *start = NULL;
+    char *processed = NULL;
+    size_t string_len = 0, output_len = 0;
+    int has_escapes = 0, equal = 0;
+    if (scan_quoted_string(&string, &start, &string_len, &output_len, &has_escapes) == JSONFailure || output_len != name_len) {
+        return 0;
+    }
+    if (!has_escapes) {
+        return memcmp(start, name, name_len) == 0;
+    }
+    string = document->string + document->tape[index].offset;
+    processed = (char*)get_quoted_string((_Ptr<_Nt_array_ptr<const char>>)&string, NULL, NULL);
+    if (processed == NULL) {
+        return 0;
+    }
+    equal = memcmp(processed, name, name_len) == 0;
+    parson_free(char, processed);
+    return equal;
+}
+
+/* Returns tape index of the value with given name in the object at index */
+static size_t json_document_find(_Ptr<const JSON_Document> document, size_t index, _Nt_array_ptr<const char> name : count(name_len), size_t name_len) {
+    size_t i = index + 1;
+    if (document->string[document->tape[index].offset] != '{') {
+        return OBJECT_NOT_FOUND;
+    }
+    while (i < document->tape[index].next) {
+        if (json_document_name_equals(document, i, name, name_len)) {
+            return i + 1;
+        }
+        i = document->tape[i + 1].next;
+    }
+    return OBJECT_NOT_FOUND;
+}
+
+/* Decodes value at index with the recursive parser on first access, the value has to end where
+   its token does. */
+static _Ptr<JSON_Value> json_document_decode(_Ptr<JSON_Document> document, size_t index) {
+    _Nt_array_ptr<const char> string = NULL;
+    _Ptr<JSON_Value> value = NULL;
+    if (document->tape[index].value != NULL) {
+        return document->tape[index].value;
+    }
+    // TODO: Offset into the string isn't bounded, so it needs an unchecked cast.
+    _Unchecked {
+        string = _Assume_bounds_cast<_Nt_array_ptr<const char>>(document->string + document->tape[index].offset, count(0));
+        value = parse_value((_Ptr<_Nt_array_ptr<const char>>)&string, NULL);
+    }
+    if (value == NULL) {
+        return NULL;
+    }
+    if (!IS_WHITESPACE(*string) && *string != ',' && *string != ']' && *string != '}' && *string != '\0') {
+        json_value_free(value);
+        return NULL;
+    }
+    document->tape[index].value = value;
+    return value;
 }
 
 /* Serialization */
 
-#define APPEND_STRING(str) do { written = append_string(buf, (str), buf_start, buf_len);\
-                                if (written < 0) { return -1; }\
-                                if (buf != NULL) { buf += written; }\
-                                written_total += written; } while(0)
+/* Makes sure there's room for len more characters and a terminating null character.
+   TODO: Reallocation changes buf and capacity separately, which the compiler can't follow. */
+static _Unchecked JSON_Status writer_reserve(_Ptr<JSON_Writer> writer, size_t len) {
+    size_t new_capacity = 0;
+    char *new_buf = NULL;
+    if (writer->buf == NULL || writer->length + len < writer->capacity) {
+        return JSONSuccess;
+    }
+    if (writer->write_callback != NULL) {
+        if (writer_flush(writer) == JSONFailure || len >= writer->capacity) {
+            return JSONFailure;
+        }
+        return JSONSuccess;
+    }
+    if (!writer->growable) {
+        return JSONFailure;
+    }
+    new_capacity = writer->capacity * 2;
+    if (new_capacity <= writer->length + len) {
+        new_capacity = writer->length + len + 1;
+    }
+    new_buf = (char*)parson_malloc(char, new_capacity);
+    if (new_buf == NULL) {
+        return JSONFailure;
+    }
+    memcpy(new_buf, writer->buf, writer->length);
+    parson_free(char, writer->buf);
+    writer->buf = new_buf;
+    writer->capacity = new_capacity;
+    return JSONSuccess;
+}
 
-#define APPEND_INDENT(level) do { written = append_indent(buf, (level), buf_start, buf_len);\
-                                  if (written < 0) { return -1; }\
-                                  if (buf != NULL) { buf += written; }\
-                                  written_total += written; } while(0)
+/* TODO: Copying to buf at length isn't expressible with checked pointers. */
+static _Unchecked JSON_Status writer_append(_Ptr<JSON_Writer> writer, const char *string : itype(_Array_ptr<const char>) count(len), size_t len) {
+    if (writer->write_callback != NULL && len >= writer->capacity) { /* wouldn't fit into buffer anyway */
+        if (writer_flush(writer) == JSONFailure || writer->write_callback(writer->context, string, len) != len) {
+            return JSONFailure;
+        }
+        return JSONSuccess;
+    }
+    if (writer_reserve(writer, len) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (writer->buf != NULL) {
+        memcpy(writer->buf + writer->length, string, len);
+    }
+    writer->length += len;
+    return JSONSuccess;
+}
 
-static int json_serialize_to_buffer_r(_Ptr<const JSON_Value> value, _Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len), int level, int is_pretty, _Nt_array_ptr<char> num_buf, _Nt_array_ptr<char> buf_start : byte_count(buf_len), size_t buf_len) {
-    _Nt_array_ptr<const char> key = NULL;
+static JSON_Status writer_append_indent(_Ptr<JSON_Writer> writer, int level) {
+    int i;
+    for (i = 0; i < level; i++) {
+        if (writer_append(writer, "    ", 4) == JSONFailure) {
+            return JSONFailure;
+        }
+    }
+    return JSONSuccess;
+}
+
+/* Numbers are formatted directly into buf if it can make room for any number. Otherwise, when
+   only size is computed or buf is fixed, they're formatted into num_buf and appended at their length.
+   TODO: Formatting at buf + length isn't expressible with checked pointers. */
+static _Unchecked JSON_Status writer_append_number(_Ptr<JSON_Writer> writer, _Ptr<const JSON_Value> value) {
+    char num_buf[NUM_BUF_SIZE];
+    char *output = num_buf;
+    int written = -1;
+    if (writer->buf != NULL && (writer->growable || writer->write_callback != NULL)) {
+        if (writer_reserve(writer, NUM_BUF_SIZE) == JSONFailure) {
+            return JSONFailure;
+        }
+        output = writer->buf + writer->length;
+    }
+    if (value->flags & VALUE_FLAG_INT64) {
+        written = format_integer(output,
+                                 value->value.integer < 0 ? (uint64_t)0 - (uint64_t)value->value.integer : (uint64_t)value->value.integer,
+                                 value->value.integer < 0);
+    } else if (value->flags & VALUE_FLAG_UINT64) {
+        written = format_integer(output, value->value.uinteger, 0);
+    } else {
+        written = format_double(output, value->value.number);
+    }
+    if (written < 0) {
+        return JSONFailure;
+    }
+    if (output == num_buf) {
+        return writer_append(writer, num_buf, (size_t)written);
+    }
+    writer->length += (size_t)written;
+    return JSONSuccess;
+}
+
+static JSON_Status writer_flush(_Ptr<JSON_Writer> writer) {
+    if (writer->length > 0 && writer->write_callback(writer->context, writer->buf, writer->length) != writer->length) {
+        return JSONFailure;
+    }
+    writer->length = 0;
+    return JSONSuccess;
+}
+
+/* Null terminates the output, or flushes it if it's streamed */
+static _Unchecked JSON_Status writer_finish(_Ptr<JSON_Writer> writer) {
+    if (writer->write_callback != NULL) {
+        return writer_flush(writer);
+    }
+    if (writer_reserve(writer, 0) == JSONFailure) {
+        return JSONFailure;
+    }
+    if (writer->buf != NULL) {
+        writer->buf[writer->length] = '\0';
+    }
+    return JSONSuccess;
+}
+
+#define APPEND_STRING(str) do { if (writer_append(writer, (str), sizeof(str) - 1) == JSONFailure) { return JSONFailure; } } while (0)
+
+#define APPEND_INDENT(level) do { if (writer_append_indent(writer, (level)) == JSONFailure) { return JSONFailure; } } while (0)
+
+static JSON_Status json_serialize_to_writer_r(_Ptr<const JSON_Value> value, _Ptr<JSON_Writer> writer, int level, int is_pretty) {
+    size_t key_len = 0, string_len = 0;
+    _Nt_array_ptr<const char> key : count(key_len) = NULL;
     _Nt_array_ptr<const char> string = NULL;
+    _Nt_array_ptr<const char> string_with_len : count(string_len) = NULL;
     _Ptr<JSON_Value> temp_value = NULL;
     _Ptr<JSON_Array> array = NULL;
     _Ptr<JSON_Object> object = NULL;
     size_t i = 0, count = 0;
-    double num = 0.0;
-    int written = -1, written_total = 0;
 
     switch (json_value_get_type(value)) {
         case JSONArray:
@@ -995,14 +4100,9 @@ static int json_serialize_to_buffer_r(_Ptr<const JSON_Value> value, _Nt_array_pt
                     APPEND_INDENT(level+1);
                 }
                 temp_value = json_array_get_value(array, i);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf, buf_start, buf_len);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_to_writer_r(temp_value, writer, level+1, is_pretty) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
                     APPEND_STRING(",");
                 }
@@ -1014,7 +4114,7 @@ static int json_serialize_to_buffer_r(_Ptr<const JSON_Value> value, _Nt_array_pt
                 APPEND_INDENT(level);
             }
             APPEND_STRING("]");
-            return written_total;
+            return JSONSuccess;
         case JSONObject:
             object = json_value_get_object(value);
             count  = json_object_get_count(object);
@@ -1023,34 +4123,24 @@ static int json_serialize_to_buffer_r(_Ptr<const JSON_Value> value, _Nt_array_pt
                 APPEND_STRING("\n");
             }
             for (i = 0; i < count; i++) {
-                key = json_object_get_name(object, i);
-                if (key == NULL) {
-                    return -1;
+                key_len = object->entries[i].length;
+                _Unchecked {
+                    key = _Assume_bounds_cast<_Nt_array_ptr<const char>>(object->entries[i].name, count(key_len));
                 }
                 if (is_pretty) {
                     APPEND_INDENT(level+1);
                 }
-                written = json_serialize_string(key, buf, buf_start, buf_len);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_string(key, key_len, writer) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 APPEND_STRING(":");
                 if (is_pretty) {
                     APPEND_STRING(" ");
                 }
-                temp_value = json_object_get_value(object, key);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf, buf_start, buf_len);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                temp_value = object->entries[i].value;
+                if (json_serialize_to_writer_r(temp_value, writer, level+1, is_pretty) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
                     APPEND_STRING(",");
                 }
@@ -1062,68 +4152,65 @@ static int json_serialize_to_buffer_r(_Ptr<const JSON_Value> value, _Nt_array_pt
                 APPEND_INDENT(level);
             }
             APPEND_STRING("}");
-            return written_total;
+            return JSONSuccess;
         case JSONString:
             string = json_value_get_string(value);
             if (string == NULL) {
-                return -1;
-            }
-            written = json_serialize_string(string, buf, buf_start, buf_len);
-            if (written < 0) {
-                return -1;
+                return JSONFailure;
             }
-            if (buf != NULL) {
-                buf += written;
+            string_len = strlen(string);
+            _Unchecked {
+                string_with_len = _Assume_bounds_cast<_Nt_array_ptr<const char>>(string, count(string_len));
             }
-            written_total += written;
-            return written_total;
+            return json_serialize_string(string_with_len, string_len, writer);
         case JSONBoolean:
             if (json_value_get_boolean(value)) {
                 APPEND_STRING("true");
             } else {
                 APPEND_STRING("false");
             }
-            return written_total;
+            return JSONSuccess;
         case JSONNumber:
-            num = json_value_get_number(value);
-            _Unchecked {
-                if (buf != NULL) {
-                    num_buf = _Assume_bounds_cast<_Nt_array_ptr<char>>(buf, count(0));
-                }
-                written = sprintf((char*)num_buf, FLOAT_FORMAT, num);
-            }
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
-            }
-            written_total += written;
-            return written_total;
+            return writer_append_number(writer, value);
         case JSONNull:
             APPEND_STRING("null");
-            return written_total;
+            return JSONSuccess;
         case JSONError:
-            return -1;
+            return JSONFailure;
         default:
-            return -1;
+            return JSONFailure;
     }
 }
 
-static int json_serialize_string(_Nt_array_ptr<const char> str_unbounded,
-                                 _Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len),
-                                 _Nt_array_ptr<char> buf_start : byte_count(buf_len),
-                                 size_t buf_len) {
-    size_t i = 0, len = strlen(str_unbounded);
-    _Nt_array_ptr<const char> string : count(len) = NULL;
-    _Unchecked {
-        string = _Assume_bounds_cast<_Nt_array_ptr<const char>>(str_unbounded, count(len));
+static JSON_Status json_serialize_string(_Nt_array_ptr<const char> string : count(len), size_t len, _Ptr<JSON_Writer> writer) {
+    APPEND_STRING("\"");
+    if (json_serialize_string_chars(string, len, writer) == JSONFailure) {
+        return JSONFailure;
     }
-    char c = '\0';
-    int written = -1, written_total = 0;
     APPEND_STRING("\"");
-    for (i = 0; i < len; i++) {
+    return JSONSuccess;
+}
+
+/* Writes escaped characters of string without quotes. string has to be followed by a null
+   character somewhere, it's scanned with scan_string up to len for runs without characters
+   to escape, which are copied at once. */
+static JSON_Status json_serialize_string_chars(_Array_ptr<const char> string : count(len), size_t len, _Ptr<JSON_Writer> writer) {
+    size_t i = 0, run_len = 0;
+    char c = '\0';
+    char stop = parson_escape_slashes ? '/' : '\"';
+    while (i < len) {
+        _Unchecked {
+            run_len = (size_t)(scan_string((const char*)string + i, (const char*)string + len, stop) - ((const char*)string + i));
+        }
+        if (writer_append(writer, _Dynamic_bounds_cast<_Array_ptr<const char>>(string + i, count(run_len)), run_len) == JSONFailure) {
+            return JSONFailure;
+        }
+        i += run_len;
+        if (i == len) {
+            break;
+        }
         c = string[i];
+        i++;
         switch (c) {
             case '\"': APPEND_STRING("\\\""); break;
             case '\\': APPEND_STRING("\\\\"); break;
@@ -1171,62 +4258,317 @@ static int json_serialize_string(_Nt_array_ptr<const char> str_unbounded,
                     APPEND_STRING("/");
                 }
                 break;
-            default: /*HACK for C3*/
-                _Unchecked {
-                    if (buf != NULL) {
-                        buf[0] = c;
-                        buf += 1;
-                    }
-                }
-                written_total += 1;
+            default:
                 break;
         }
     }
-    APPEND_STRING("\"");
-    return written_total;
+    return JSONSuccess;
 }
 
-static int append_indent(_Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len),
-                         int level,
-                         _Nt_array_ptr<char> buf_start : byte_count(buf_len),
-                         size_t buf_len) {
-    int i;
-    int written = -1, written_total = 0;
-    for (i = 0; i < level; i++) {
-        APPEND_STRING("    ");
-    }
-    return written_total;
+static JSON_Status json_serializer_push(_Ptr<JSON_Serializer> serializer, _Ptr<const JSON_Value> value) {
+    size_t new_capacity = 0;
+    _Array_ptr<JSON_Serializer_Frame> new_stack : count(new_capacity) = NULL;
+    if (serializer->stack_count == serializer->stack_capacity) {
+        new_capacity = serializer->stack_capacity * 2;
+        new_stack = parson_malloc(JSON_Serializer_Frame, new_capacity * sizeof(JSON_Serializer_Frame));
+        if (new_stack == NULL) {
+            return JSONFailure;
+        }
+        memcpy<JSON_Serializer_Frame>(_Dynamic_bounds_cast<_Array_ptr<JSON_Serializer_Frame>>(new_stack, count(serializer->stack_count)),
+                                      _Dynamic_bounds_cast<_Array_ptr<JSON_Serializer_Frame>>(serializer->stack, count(serializer->stack_count)),
+                                      serializer->stack_count * sizeof(JSON_Serializer_Frame));
+        parson_free(JSON_Serializer_Frame, serializer->stack);
+        // TODO: The two statements below need to be changed atomically
+        serializer->stack = new_stack;
+        serializer->stack_capacity = new_capacity;
+    }
+    serializer->stack[serializer->stack_count].value = value;
+    serializer->stack[serializer->stack_count].index = 0;
+    serializer->stack_count++;
+    return JSONSuccess;
 }
 
-static int append_string(_Nt_array_ptr<char> buf : bounds(buf_start, buf_start + buf_len),
-                         _Nt_array_ptr<const char> string,
-                         _Nt_array_ptr<char> buf_start : byte_count(buf_len),
-                         size_t buf_len) {
-    size_t len = strlen(string);
-    if (buf == NULL) {
-        return (int) len;
+static JSON_Status json_serializer_start_string(_Ptr<JSON_Serializer> serializer, _Nt_array_ptr<const char> string : count(len), size_t len, int is_key) {
+    _Ptr<JSON_Writer> writer = &serializer->pending;
+    APPEND_STRING("\"");
+    // TODO: The two statements below need to be changed atomically
+    serializer->string = string;
+    serializer->string_len = len;
+    serializer->string_offset = 0;
+    serializer->string_is_key = is_key;
+    return JSONSuccess;
+}
+
+/* Appends next piece of output to pending: a slice of current string, start of next value,
+   a separator with following object key or end of a container. Containers are kept on explicit
+   stack instead of recursion, so serialization can stop after any step. */
+static JSON_Status json_serializer_step(_Ptr<JSON_Serializer> serializer) {
+    _Ptr<JSON_Writer> writer = &serializer->pending;
+    _Ptr<const JSON_Value> value = NULL;
+    _Ptr<JSON_Serializer_Frame> frame = NULL;
+    _Nt_array_ptr<const char> string = NULL;
+    size_t slice_len = 0, count = 0, key_len = 0, string_len = 0;
+    _Nt_array_ptr<const char> key : count(key_len) = NULL;
+    _Nt_array_ptr<const char> string_with_len : count(string_len) = NULL;
+    _Ptr<JSON_Object> object = NULL;
+    int level = 0;
+
+    if (serializer->string != NULL) {
+        slice_len = serializer->string_len - serializer->string_offset;
+        if (slice_len > SERIALIZER_STRING_SLICE) {
+            slice_len = SERIALIZER_STRING_SLICE;
+        }
+        if (json_serialize_string_chars(_Dynamic_bounds_cast<_Array_ptr<const char>>(serializer->string + serializer->string_offset, count(slice_len)),
+                                        slice_len, writer) == JSONFailure) {
+            return JSONFailure;
+        }
+        serializer->string_offset += slice_len;
+        if (serializer->string_offset < serializer->string_len) {
+            return JSONSuccess;
+        }
+        // TODO: The two statements below need to be changed atomically
+        serializer->string = NULL;
+        serializer->string_len = 0;
+        APPEND_STRING("\"");
+        if (serializer->string_is_key) {
+            APPEND_STRING(":");
+            if (serializer->is_pretty) {
+                APPEND_STRING(" ");
+            }
+            frame = &serializer->stack[serializer->stack_count - 1];
+            serializer->next_value = json_object_get_value_at(json_value_get_object(frame->value), frame->index - 1);
+        }
+        return JSONSuccess;
+    }
+
+    if (serializer->next_value != NULL) {
+        value = serializer->next_value;
+        serializer->next_value = NULL;
+        switch (json_value_get_type(value)) {
+            case JSONArray:
+            case JSONObject:
+                count = json_value_get_type(value) == JSONArray ? json_array_get_count(json_value_get_array(value))
+                                                                : json_object_get_count(json_value_get_object(value));
+                if (json_value_get_type(value) == JSONArray) {
+                    APPEND_STRING("[");
+                } else {
+                    APPEND_STRING("{");
+                }
+                if (count > 0 && serializer->is_pretty) {
+                    APPEND_STRING("\n");
+                }
+                return json_serializer_push(serializer, value);
+            case JSONString:
+                string = json_value_get_string(value);
+                if (string == NULL) {
+                    return JSONFailure;
+                }
+                string_len = strlen(string);
+                _Unchecked {
+                    string_with_len = _Assume_bounds_cast<_Nt_array_ptr<const char>>(string, count(string_len));
+                }
+                return json_serializer_start_string(serializer, string_with_len, string_len, 0);
+            case JSONNumber:
+            case JSONBoolean:
+            case JSONNull:
+                return json_serialize_to_writer_r(value, writer, 0, 0);
+            default:
+                return JSONFailure;
+        }
     }
 
-    // TODO: This does not go through properly if bounded string is a const char, as it should be
-    _Array_ptr<char> boundedString : count(len) = NULL;
+    if (serializer->stack_count == 0) {
+        return JSONSuccess;
+    }
+    frame = &serializer->stack[serializer->stack_count - 1];
+    level = (int)serializer->stack_count - 1;
+    if (json_value_get_type(frame->value) == JSONArray) {
+        count = json_array_get_count(json_value_get_array(frame->value));
+    } else {
+        object = json_value_get_object(frame->value);
+        count = json_object_get_count(object);
+    }
+    if (frame->index == count) {
+        if (count > 0 && serializer->is_pretty) {
+            APPEND_STRING("\n");
+            APPEND_INDENT(level);
+        }
+        if (object == NULL) {
+            APPEND_STRING("]");
+        } else {
+            APPEND_STRING("}");
+        }
+        serializer->stack_count--;
+        return JSONSuccess;
+    }
+    if (frame->index > 0) {
+        APPEND_STRING(",");
+        if (serializer->is_pretty) {
+            APPEND_STRING("\n");
+        }
+    }
+    if (serializer->is_pretty) {
+        APPEND_INDENT(level + 1);
+    }
+    frame->index++;
+    if (object == NULL) {
+        serializer->next_value = json_array_get_value(json_value_get_array(frame->value), frame->index - 1);
+        return JSONSuccess;
+    }
+    key_len = object->entries[frame->index - 1].length;
     _Unchecked {
-        boundedString = _Assume_bounds_cast<_Array_ptr<char>>(string, count(len));
+        key = _Assume_bounds_cast<_Nt_array_ptr<const char>>(object->entries[frame->index - 1].name, count(key_len));
     }
-    _Dynamic_check(buf >= buf_start && buf + len < buf_start + buf_len);
-    _Nt_array_ptr<char> buf_tmp : count(len) = _Dynamic_bounds_cast<_Nt_array_ptr<char>>(buf, count(len));
-    memcpy<char>(buf_tmp,
-                 boundedString,
-                 len);
-    buf[len] = '\0';
-    return len;
+    return json_serializer_start_string(serializer, key, key_len, 1);
 }
 #undef APPEND_STRING
 #undef APPEND_INDENT
 
+static size_t json_serialization_size_internal(_Ptr<const JSON_Value> value, int is_pretty) {
+    JSON_Writer writer = { NULL, 0, 0, 0, NULL, NULL };
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure) {
+        return 0;
+    }
+    return writer.length + 1;
+}
+
+static JSON_Status json_serialize_to_buffer_internal(_Ptr<const JSON_Value> value, _Nt_array_ptr<char> buf : byte_count(buf_size_in_bytes), size_t buf_size_in_bytes, int is_pretty) {
+    JSON_Writer writer = { buf, buf_size_in_bytes, 0, 0, NULL, NULL };
+    if (buf == NULL || buf_size_in_bytes == 0) {
+        return JSONFailure;
+    }
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure || writer_finish(&writer) == JSONFailure) {
+        buf[0] = '\0';
+        return JSONFailure;
+    }
+    return JSONSuccess;
+}
+
+/* TODO: Returned buffer's bounds come from the writer, which the compiler can't follow. */
+static _Unchecked _Nt_array_ptr<char> json_serialize_to_string_internal(_Ptr<const JSON_Value> value, int is_pretty) {
+    JSON_Writer writer = { NULL, 0, 0, 1, NULL, NULL };
+    writer.buf = (char*)parson_malloc(char, SERIALIZATION_STARTING_CAPACITY);
+    if (writer.buf == NULL) {
+        return NULL;
+    }
+    writer.capacity = SERIALIZATION_STARTING_CAPACITY;
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure || writer_finish(&writer) == JSONFailure) {
+        parson_free(char, writer.buf);
+        return NULL;
+    }
+    return _Assume_bounds_cast<_Nt_array_ptr<char>>(writer.buf, count(0));
+}
+
+/* TODO: *buf and *buf_size are updated separately, which the compiler can't follow. */
+static _Unchecked JSON_Status json_serialize_to_reusable_buffer_internal(_Ptr<const JSON_Value> value, _Ptr<_Nt_array_ptr<char>> buf, _Ptr<size_t> buf_size, int is_pretty) {
+    JSON_Writer writer = { NULL, 0, 0, 1, NULL, NULL };
+    JSON_Status status = JSONFailure;
+    if (buf == NULL || buf_size == NULL) {
+        return JSONFailure;
+    }
+    writer.buf = (char*)*buf;
+    writer.capacity = writer.buf != NULL ? *buf_size : 0;
+    if (writer.buf == NULL) {
+        writer.buf = (char*)parson_malloc(char, SERIALIZATION_STARTING_CAPACITY);
+        if (writer.buf == NULL) {
+            return JSONFailure;
+        }
+        writer.capacity = SERIALIZATION_STARTING_CAPACITY;
+    }
+    status = json_serialize_to_writer_r(value, &writer, 0, is_pretty);
+    if (status == JSONSuccess) {
+        status = writer_finish(&writer);
+    }
+    if (status == JSONFailure && writer.capacity > 0) {
+        writer.buf[0] = '\0';
+    }
+    *buf = _Assume_bounds_cast<_Nt_array_ptr<char>>(writer.buf, count(0));
+    *buf_size = writer.capacity;
+    return status;
+}
+
+/* TODO: Unchecked because context is passed through as void pointer. */
+static _Unchecked size_t write_to_file(void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len) {
+    return fwrite(data, 1, len, (FILE*)context);
+}
+
+/* TODO: Unchecked because context is passed through as void pointer. */
+static _Unchecked size_t write_to_fd(void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len) {
+    int fd = *(int*)context;
+    size_t written_total = 0;
+    long written = 0;
+    while (written_total < len) {
+        written = (long)parson_write_fd(fd, data + written_total, len - written_total);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            break;
+        }
+        written_total += (size_t)written;
+    }
+    return written_total;
+}
+
+/* Output goes through a fixed buffer on stack, so memory use doesn't depend on size of the output */
+static JSON_Status json_serialize_to_callback_internal(_Ptr<const JSON_Value> value, _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback, void *context : itype(_Ptr<void>), int is_pretty) {
+    char buf _Checked[SERIALIZATION_STREAM_BUFFER_SIZE];
+    JSON_Writer writer = { buf, SERIALIZATION_STREAM_BUFFER_SIZE, 0, 0, write_callback, context };
+    if (write_callback == NULL || json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure) {
+        return JSONFailure;
+    }
+    return writer_finish(&writer);
+}
+
+static JSON_Status json_serialize_to_file_internal(_Ptr<const JSON_Value> value, _Nt_array_ptr<const char> filename, int is_pretty) {
+    JSON_Status return_code = JSONSuccess;
+    _Ptr<FILE> fp = NULL;
+    if (json_value_get_type(value) == JSONError) {
+        return JSONFailure;
+    }
+    fp = fopen(filename, "w");
+    if (fp == NULL) {
+        return JSONFailure;
+    }
+    return_code = json_serialize_to_callback_internal(value, write_to_file, fp, is_pretty);
+    if (fclose(fp) == EOF) {
+        return_code = JSONFailure;
+    }
+    return return_code;
+}
+
+static _Ptr<JSON_Serializer> json_serializer_init_internal(_Ptr<const JSON_Value> value, int is_pretty) {
+    _Ptr<JSON_Serializer> serializer = NULL;
+    if (json_value_get_type(value) == JSONError) {
+        return NULL;
+    }
+    serializer = parson_malloc(JSON_Serializer, sizeof(JSON_Serializer));
+    if (serializer == NULL) {
+        return NULL;
+    }
+    memset<JSON_Serializer>(serializer, 0, sizeof(JSON_Serializer));
+    serializer->stack = parson_malloc(JSON_Serializer_Frame, SERIALIZER_STARTING_DEPTH * sizeof(JSON_Serializer_Frame));
+    serializer->pending.buf = parson_malloc(char, SERIALIZATION_STARTING_CAPACITY);
+    if (serializer->stack == NULL || serializer->pending.buf == NULL) {
+        json_serializer_free(serializer);
+        return NULL;
+    }
+    serializer->stack_capacity = SERIALIZER_STARTING_DEPTH;
+    serializer->pending.capacity = SERIALIZATION_STARTING_CAPACITY;
+    serializer->pending.growable = 1;
+    serializer->next_value = value;
+    serializer->is_pretty = is_pretty;
+    return serializer;
+}
+
 /* Parser API */
 JSON_Value * json_parse_file(const char *filename : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
-    _Nt_array_ptr<char> file_contents = read_file((_Nt_array_ptr<const char>)filename);
+    _Nt_array_ptr<char> file_contents = NULL;
     _Ptr<JSON_Value> output_value = NULL;
+    if (parse_mapped_file(filename, 0, &output_value) == JSONSuccess) {
+        return output_value;
+    }
+    file_contents = read_file((_Nt_array_ptr<const char>)filename);
     if (file_contents == NULL) {
         return NULL;
     }
@@ -1236,8 +4578,12 @@ JSON_Value * json_parse_file(const char *filename : itype(_Nt_array_ptr<const ch
 }
 
 JSON_Value * json_parse_file_with_comments(const char *filename : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
-    _Nt_array_ptr<char> file_contents = read_file((_Nt_array_ptr<const char>)filename);
+    _Nt_array_ptr<char> file_contents = NULL;
     _Ptr<JSON_Value> output_value = NULL;
+    if (parse_mapped_file(filename, 1, &output_value) == JSONSuccess) {
+        return output_value;
+    }
+    file_contents = read_file((_Nt_array_ptr<const char>)filename);
     if (file_contents == NULL) {
         return NULL;
     }
@@ -1246,34 +4592,273 @@ JSON_Value * json_parse_file_with_comments(const char *filename : itype(_Nt_arra
     return output_value;
 }
 
-JSON_Value * json_parse_string(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
-    if (string == NULL) {
-        return NULL;
+JSON_Value * json_parse_file_in_situ(const char *filename : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
+    _Nt_array_ptr<char> file_contents = read_file((_Nt_array_ptr<const char>)filename);
+    if (file_contents == NULL) {
+        return NULL;
+    }
+    return json_parse_string_in_situ(file_contents);
+}
+
+JSON_Value * json_parse_string(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
+    if (string == NULL) {
+        return NULL;
+    }
+    _Unchecked {
+        const char* tmp = string;
+        if (tmp[0] == '\xEF' && tmp[1] == '\xBB' && tmp[2] == '\xBF') {
+            string = string + 3; /* Support for UTF-8 BOM */
+        }
+        return parse_value((_Ptr<_Nt_array_ptr<const char>>)&string, NULL);
+    }
+}
+
+/* Comments are skipped by the tokenizer of the push parser, so the string isn't copied first */
+JSON_Value * json_parse_string_with_comments(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
+    size_t string_len = 0;
+    if (string == NULL) {
+        return NULL;
+    }
+    string_len = strlen(string);
+    _Unchecked {
+        return json_parse_buffer_internal(_Assume_bounds_cast<_Array_ptr<const char>>(string, count(string_len)), string_len, 1);
+    }
+}
+
+JSON_Value * json_parse_buffer(const char *buf : itype(_Array_ptr<const char>) count(len), size_t len) : itype(_Ptr<JSON_Value>) {
+    return json_parse_buffer_internal(buf, len, 0);
+}
+
+JSON_Value * json_parse_buffer_with_comments(const char *buf : itype(_Array_ptr<const char>) count(len), size_t len) : itype(_Ptr<JSON_Value>) {
+    return json_parse_buffer_internal(buf, len, 1);
+}
+
+JSON_Value * json_parse_string_arena(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
+    _Ptr<JSON_Arena> arena = NULL;
+    _Ptr<JSON_Value> result = NULL;
+    size_t string_len = 0;
+    if (string == NULL) {
+        return NULL;
+    }
+    string_len = strlen(string);
+    /* parsed tree is usually up to twice as big as its text */
+    arena = json_arena_init(string_len < SIZE_MAX / 2 ? string_len * 2 : string_len);
+    if (arena == NULL) {
+        return NULL;
+    }
+    _Unchecked {
+        const char* tmp = string;
+        if (tmp[0] == '\xEF' && tmp[1] == '\xBB' && tmp[2] == '\xBF') {
+            string = string + 3; /* Support for UTF-8 BOM */
+        }
+        result = parse_value((_Ptr<_Nt_array_ptr<const char>>)&string, arena);
+    }
+    if (result == NULL) {
+        json_arena_free(arena);
+        return NULL;
+    }
+    return json_arena_set_root(arena, result);
+}
+
+JSON_Value * json_parse_string_in_situ(char *string : itype(_Nt_array_ptr<char>)) : itype(_Ptr<JSON_Value>) {
+    _Ptr<JSON_Arena> arena = NULL;
+    _Ptr<JSON_Value> result = NULL;
+    if (string == NULL) {
+        return NULL;
+    }
+    /* strings stay in the buffer, so the tree needs less memory than its text */
+    arena = json_arena_init(strlen(string));
+    if (arena == NULL) {
+        parson_free(char, string);
+        return NULL;
+    }
+    arena->buffer = string;
+    _Unchecked {
+        const char* tmp = string;
+        if (tmp[0] == '\xEF' && tmp[1] == '\xBB' && tmp[2] == '\xBF') {
+            tmp = tmp + 3; /* Support for UTF-8 BOM */
+        }
+        result = parse_value((_Ptr<_Nt_array_ptr<const char>>)&tmp, arena);
+    }
+    if (result == NULL) {
+        json_arena_free(arena);
+        return NULL;
+    }
+    return json_arena_set_root(arena, result);
+}
+
+JSON_Status json_parse_string_sax(const char *string : itype(_Nt_array_ptr<const char>),
+                                  const JSON_Sax_Callbacks *callbacks : itype(_Ptr<const JSON_Sax_Callbacks>),
+                                  void *context : itype(_Ptr<void>)) {
+    JSON_Sax_State state = { callbacks, context, NULL, 0, { NULL, 0, 0, 1, NULL, NULL } };
+    JSON_Status status = JSONFailure;
+    if (string == NULL || callbacks == NULL) {
+        return JSONFailure;
+    }
+    state.containers.buf = parson_malloc(char, STARTING_CAPACITY);
+    if (state.containers.buf == NULL) {
+        return JSONFailure;
+    }
+    state.containers.capacity = STARTING_CAPACITY;
+    _Unchecked {
+        const char* tmp = string;
+        if (tmp[0] == '\xEF' && tmp[1] == '\xBB' && tmp[2] == '\xBF') {
+            string = string + 3; /* Support for UTF-8 BOM */
+        }
+        status = sax_parse_value((_Ptr<_Nt_array_ptr<const char>>)&string, &state);
+    }
+    parson_free(char, state.buffer);
+    parson_free(char, state.containers.buf);
+    return status;
+}
+
+JSON_Document * json_document_parse(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Document>) {
+    _Ptr<JSON_Document> document = NULL;
+    JSON_Status status = JSONFailure;
+    if (string == NULL) {
+        return NULL;
+    }
+    document = parson_malloc(JSON_Document, sizeof(JSON_Document));
+    if (document == NULL) {
+        return NULL;
+    }
+    memset<JSON_Document>(document, 0, sizeof(JSON_Document));
+    document->string = parson_strdup((_Nt_array_ptr<const char>)string);
+    document->tape = parson_malloc(JSON_Tape_Entry, TAPE_STARTING_CAPACITY * sizeof(JSON_Tape_Entry));
+    if (document->string == NULL || document->tape == NULL) {
+        json_document_free(document);
+        return NULL;
+    }
+    document->tape_capacity = TAPE_STARTING_CAPACITY;
+    _Unchecked {
+        const char* tmp = document->string;
+        if (tmp[0] == '\xEF' && tmp[1] == '\xBB' && tmp[2] == '\xBF') {
+            tmp = tmp + 3; /* Support for UTF-8 BOM */
+        }
+        status = json_tape_build_value(document, (_Ptr<_Nt_array_ptr<const char>>)&tmp);
+    }
+    if (status == JSONFailure) {
+        json_document_free(document);
+        return NULL;
+    }
+    return document;
+}
+
+JSON_Value_Type json_document_get_type(const JSON_Document *document : itype(_Ptr<const JSON_Document>)) {
+    if (document == NULL) {
+        return JSONError;
+    }
+    switch (document->string[document->tape[0].offset]) {
+        case '{':  return JSONObject;
+        case '[':  return JSONArray;
+        case '\"': return JSONString;
+        case 't': case 'f': return JSONBoolean;
+        case 'n':  return JSONNull;
+        default:   return JSONNumber;
+    }
+}
+
+JSON_Value * json_document_get_value(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
+    size_t name_len = 0, i = 0;
+    _Nt_array_ptr<const char> name_with_len : count(name_len) = NULL;
+    if (document == NULL || name == NULL) {
+        return NULL;
+    }
+    name_len = strlen(name);
+    _Unchecked {
+        name_with_len = _Assume_bounds_cast<_Nt_array_ptr<const char>>(name, count(name_len));
+    }
+    i = json_document_find(document, 0, name_with_len, name_len);
+    if (i == OBJECT_NOT_FOUND) {
+        return NULL;
+    }
+    return json_document_decode(document, i);
+}
+
+JSON_Value * json_document_dotget_value(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
+    size_t i = 0, name_len = 0;
+    _Nt_array_ptr<const char> dot_position = NULL;
+    _Nt_array_ptr<const char> name_with_len : count(name_len) = NULL;
+    if (document == NULL || name == NULL) {
+        return NULL;
+    }
+    /* Only the last value is decoded, objects on the way are searched on the tape */
+    for (;;) {
+        dot_position = strchr(name, '.');
+        name_len = dot_position != NULL ? (size_t)(dot_position - name) : strlen(name);
+        _Unchecked {
+            name_with_len = _Assume_bounds_cast<_Nt_array_ptr<const char>>(name, count(name_len));
+        }
+        i = json_document_find(document, i, name_with_len, name_len);
+        if (i == OBJECT_NOT_FOUND) {
+            return NULL;
+        }
+        if (dot_position == NULL) {
+            return json_document_decode(document, i);
+        }
+        _Unchecked {
+            name = _Assume_bounds_cast<_Nt_array_ptr<const char>>(dot_position + 1, count(0));
+        }
+    }
+}
+
+const char * json_document_dotget_string(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Nt_array_ptr<const char>) {
+    return json_value_get_string(json_document_dotget_value(document, name));
+}
+
+double json_document_dotget_number(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) {
+    return json_value_get_number(json_document_dotget_value(document, name));
+}
+
+int json_document_dotget_boolean(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) {
+    return json_value_get_boolean(json_document_dotget_value(document, name));
+}
+
+void json_document_free(JSON_Document *document : itype(_Ptr<JSON_Document>)) {
+    size_t i = 0;
+    if (document == NULL) {
+        return;
+    }
+    for (i = 0; i < document->tape_count; i++) {
+        if (document->tape[i].value != NULL) {
+            json_value_free(document->tape[i].value);
+        }
+    }
+    parson_free(JSON_Tape_Entry, document->tape);
+    parson_free(char, document->string);
+    parson_free(JSON_Document, document);
+}
+
+JSON_Parser * json_parser_init(void) : itype(_Ptr<JSON_Parser>) {
+    return json_parser_init_internal(0);
+}
+
+JSON_Status json_parser_feed(JSON_Parser *parser : itype(_Ptr<JSON_Parser>), const char *chunk : itype(_Array_ptr<const char>) count(len), size_t len) {
+    if (parser == NULL || parser->failed || (chunk == NULL && len > 0)) {
+        return JSONFailure;
     }
-    _Unchecked {
-        const char* tmp = string;
-        if (tmp[0] == '\xEF' && tmp[1] == '\xBB' && tmp[2] == '\xBF') {
-            string = string + 3; /* Support for UTF-8 BOM */
-        }
-        return parse_value((_Ptr<_Nt_array_ptr<const char>>)&string, 0);
+    if (json_parser_scan(parser, chunk, len) == JSONFailure) {
+        parser->failed = 1;
+        return JSONFailure;
     }
+    return JSONSuccess;
 }
 
-JSON_Value * json_parse_string_with_comments(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
-    _Ptr<JSON_Value> result = NULL;    
-    _Nt_array_ptr<char> string_mutable_copy = parson_strdup((_Nt_array_ptr<const char>)string);
-    if (string_mutable_copy == NULL) {
+JSON_Value * json_parser_finish(JSON_Parser *parser : itype(_Ptr<JSON_Parser>)) : itype(_Ptr<JSON_Value>) {
+    _Ptr<JSON_Value> result = NULL;
+    if (parser == NULL) {
         return NULL;
     }
-    remove_comments(string_mutable_copy, "/*", "*/");
-    remove_comments(string_mutable_copy, "//", "\n");
-    _Unchecked {
-        const char* string_mutable_copy_ptr[1] = { NULL };
-        string_mutable_copy_ptr[0] = (const char*)string_mutable_copy;
-        result = parse_value((_Ptr<_Nt_array_ptr<const char>>)string_mutable_copy_ptr, 0);
-        parson_free(char, string_mutable_copy);
-        return result;
+    if (!parser->failed && (parser->token_type == PARSER_TOKEN_NUMBER || parser->token_type == PARSER_TOKEN_LITERAL) &&
+        json_parser_end_token(parser) == JSONFailure) { /* numbers and literals end with the input */
+        parser->failed = 1;
     }
+    if (!parser->failed && parser->state == PARSER_STATE_DONE) {
+        result = parser->root;
+        parser->root = NULL;
+    }
+    json_parser_free(parser);
+    return result;
 }
 
 /* JSON Object API */
@@ -1298,6 +4883,14 @@ double json_object_get_number(const JSON_Object *object : itype(_Ptr<const JSON_
     return json_value_get_number(json_object_get_value(object, name));
 }
 
+int64_t json_object_get_int64(const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)) {
+    return json_value_get_int64(json_object_get_value(object, name));
+}
+
+uint64_t json_object_get_uint64(const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)) {
+    return json_value_get_uint64(json_object_get_value(object, name));
+}
+
 JSON_Object * json_object_get_object(const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Object>) {
     return json_value_get_object(json_object_get_value(object, name));
 }
@@ -1355,14 +4948,14 @@ const char * json_object_get_name(const JSON_Object *object : itype(_Ptr<const J
     if (object == NULL || index >= json_object_get_count(object)) {
         return NULL;
     }
-    return object->names[index];
+    return object->entries[index].name;
 }
 
 JSON_Value * json_object_get_value_at(const JSON_Object *object : itype(_Ptr<const JSON_Object>), size_t index) : itype(_Ptr<JSON_Value>) {
     if (object == NULL || index >= json_object_get_count(object)) {
         return NULL;
     }
-    return object->values[index];
+    return object->entries[index].value;
 }
 
 JSON_Value *json_object_get_wrapping_value(const JSON_Object *object : itype(_Ptr<const JSON_Object>)) : itype(_Ptr<JSON_Value>) {
@@ -1392,6 +4985,9 @@ JSON_Value * json_array_get_value(const JSON_Array *array : itype(_Ptr<const JSO
     if (array == NULL || index >= json_array_get_count(array)) {
         return NULL;
     }
+    if (json_array_is_packed(array)) {
+        return &json_array_values(array)[index];
+    }
     return array->items[index];
 }
 
@@ -1403,6 +4999,14 @@ double json_array_get_number(const JSON_Array *array : itype(_Ptr<const JSON_Arr
     return json_value_get_number(json_array_get_value(array, index));
 }
 
+int64_t json_array_get_int64(const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index) {
+    return json_value_get_int64(json_array_get_value(array, index));
+}
+
+uint64_t json_array_get_uint64(const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index) {
+    return json_value_get_uint64(json_array_get_value(array, index));
+}
+
 JSON_Object * json_array_get_object(const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index) : itype(_Ptr<JSON_Object>) {
     return json_value_get_object(json_array_get_value(array, index));
 }
@@ -1415,6 +5019,28 @@ int json_array_get_boolean(const JSON_Array *array : itype(_Ptr<const JSON_Array
     return json_value_get_boolean(json_array_get_value(array, index));
 }
 
+/* Packed arrays are read straight from their values, without going through items */
+size_t json_array_get_numbers(const JSON_Array *array : itype(_Ptr<const JSON_Array>), double *out : itype(_Array_ptr<double>) count(n), size_t n) {
+    _Array_ptr<JSON_Value> values : count(array->values_count) = NULL;
+    _Ptr<JSON_Value> item = NULL;
+    size_t i = 0;
+    if (array != NULL && json_array_is_packed(array)) {
+        values = json_array_values(array);
+        for (i = 0; i < n && i < array->count && values[i].type == JSONNumber; i++) {
+            out[i] = values[i].flags & VALUE_FLAG_INTEGER ? json_value_get_number(&values[i]) : values[i].value.number;
+        }
+        return i;
+    }
+    for (i = 0; i < n && i < json_array_get_count(array); i++) {
+        item = array->items[i];
+        if (json_value_get_type(item) != JSONNumber) {
+            break;
+        }
+        out[i] = json_value_get_number(item);
+    }
+    return i;
+}
+
 size_t json_array_get_count(const JSON_Array *array : itype(_Ptr<const JSON_Array>)) {
     return array ? array->count : 0;
 }
@@ -1437,11 +5063,56 @@ JSON_Array * json_value_get_array(const JSON_Value *value : itype(_Ptr<const JSO
 }
 
 const char * json_value_get_string(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Nt_array_ptr<const char>) {
-    return json_value_get_type(value) == JSONString ? value->value.string : NULL;
+    if (json_value_get_type(value) != JSONString) {
+        return NULL;
+    }
+    return (value->flags & VALUE_FLAG_SHORT_STRING) ? value->value.short_string : value->value.string;
 }
 
 double json_value_get_number(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
-    return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
+    if (json_value_get_type(value) != JSONNumber) {
+        return 0;
+    }
+    if (value->flags & VALUE_FLAG_INT64) {
+        return (double)value->value.integer;
+    }
+    if (value->flags & VALUE_FLAG_UINT64) {
+        return (double)value->value.uinteger;
+    }
+    return value->value.number;
+}
+
+int64_t json_value_get_int64(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
+    if (json_value_get_type(value) != JSONNumber || (value->flags & VALUE_FLAG_UINT64)) {
+        return 0;
+    }
+    if (value->flags & VALUE_FLAG_INT64) {
+        return value->value.integer;
+    }
+    if (value->value.number >= -9223372036854775808.0 && value->value.number < 9223372036854775808.0) {
+        return (int64_t)value->value.number;
+    }
+    return 0;
+}
+
+uint64_t json_value_get_uint64(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
+    if (json_value_get_type(value) != JSONNumber) {
+        return 0;
+    }
+    if (value->flags & VALUE_FLAG_UINT64) {
+        return value->value.uinteger;
+    }
+    if (value->flags & VALUE_FLAG_INT64) {
+        return value->value.integer >= 0 ? (uint64_t)value->value.integer : 0;
+    }
+    if (value->value.number > -1.0 && value->value.number < 18446744073709551616.0) {
+        return (uint64_t)value->value.number;
+    }
+    return 0;
+}
+
+int json_value_is_integer(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
+    return json_value_get_type(value) == JSONNumber && (value->flags & VALUE_FLAG_INTEGER) != 0;
 }
 
 int json_value_get_boolean(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
@@ -1453,12 +5124,21 @@ JSON_Value * json_value_get_parent (const JSON_Value *value : itype(_Ptr<const J
 }
 
 void json_value_free(JSON_Value *value : itype(_Ptr<JSON_Value>)) {
+    if (value != NULL && (value->flags & VALUE_FLAG_ARENA)) {
+        json_value_free_arena(value);
+        return;
+    }
+    if (value != NULL && (value->flags & VALUE_FLAG_PACKED)) {
+        return; /* released with its array, nulls, booleans and numbers own nothing else */
+    }
     switch (json_value_get_type(value)) {
         case JSONObject:
             json_object_free(value->value.object);
             break;
         case JSONString:
-            parson_free(char, value->value.string);
+            if (!(value->flags & VALUE_FLAG_SHORT_STRING)) {
+                parson_free(char, value->value.string);
+            }
             break;
         case JSONArray:
             json_array_free(value->value.array);
@@ -1470,33 +5150,11 @@ void json_value_free(JSON_Value *value : itype(_Ptr<JSON_Value>)) {
 }
 
 JSON_Value * json_value_init_object(void) : itype(_Ptr<JSON_Value>) {
-    _Ptr<JSON_Value> new_value = parson_malloc(JSON_Value, sizeof(JSON_Value));
-    if (!new_value) {
-        return NULL;
-    }
-    new_value->parent = NULL;
-    new_value->type = JSONObject;
-    new_value->value.object = json_object_init(new_value);
-    if (!new_value->value.object) {
-        parson_free(JSON_Value, new_value);
-        return NULL;
-    }
-    return new_value;
+    return json_value_init_object_internal(NULL, OBJECT_INLINE_CAPACITY);
 }
 
 JSON_Value * json_value_init_array(void) : itype(_Ptr<JSON_Value>) {
-    _Ptr<JSON_Value> new_value = parson_malloc(JSON_Value, sizeof(JSON_Value));
-    if (!new_value) {
-        return NULL;
-    }
-    new_value->parent = NULL;
-    new_value->type = JSONArray;
-    new_value->value.array = json_array_init(new_value);
-    if (!new_value->value.array) {
-        parson_free(JSON_Value, new_value);
-        return NULL;
-    }
-    return new_value;
+    return json_value_init_array_internal(NULL, ARRAY_INLINE_CAPACITY);
 }
 
 JSON_Value * json_value_init_string(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>) {
@@ -1514,11 +5172,14 @@ JSON_Value * json_value_init_string(const char *string : itype(_Nt_array_ptr<con
     if (!is_valid_utf8(str_with_len, string_len)) {
         return NULL;
     }
+    if (string_len < SHORT_STRING_CAPACITY) {
+        return json_value_init_short_string(str_with_len, string_len);
+    }
     copy = parson_strndup(str_with_len, string_len);
     if (copy == NULL) {
         return NULL;
     }
-    value = json_value_init_string_no_copy(copy);
+    value = json_value_init_string_no_copy(copy, NULL);
     if (value == NULL) {
         parson_free(char, copy);
     }
@@ -1530,37 +5191,51 @@ JSON_Value * json_value_init_number(double number) : itype(_Ptr<JSON_Value>) {
     if (IS_NUMBER_INVALID(number)) {
         return NULL;
     }
-    new_value = parson_malloc(JSON_Value, sizeof(JSON_Value));
+    new_value = json_value_alloc(NULL, JSONNumber);
     if (new_value == NULL) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONNumber;
     new_value->value.number = number;
     return new_value;
 }
 
-JSON_Value * json_value_init_boolean(int boolean) : itype(_Ptr<JSON_Value>) {
-    _Ptr<JSON_Value> new_value = parson_malloc(JSON_Value, sizeof(JSON_Value));
-    if (!new_value) {
+JSON_Value * json_value_init_int64(int64_t number) : itype(_Ptr<JSON_Value>) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(NULL, JSONNumber);
+    if (new_value == NULL) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONBoolean;
-    new_value->value.boolean = boolean ? 1 : 0;
+    new_value->flags |= VALUE_FLAG_INT64;
+    new_value->value.integer = number;
     return new_value;
 }
 
-JSON_Value * json_value_init_null(void) : itype(_Ptr<JSON_Value>) {
-    _Ptr<JSON_Value> new_value = parson_malloc(JSON_Value, sizeof(JSON_Value));
+JSON_Value * json_value_init_uint64(uint64_t number) : itype(_Ptr<JSON_Value>) {
+    _Ptr<JSON_Value> new_value = NULL;
+    if (number <= (uint64_t)INT64_MAX) {
+        return json_value_init_int64((int64_t)number);
+    }
+    new_value = json_value_alloc(NULL, JSONNumber);
+    if (new_value == NULL) {
+        return NULL;
+    }
+    new_value->flags |= VALUE_FLAG_UINT64;
+    new_value->value.uinteger = number;
+    return new_value;
+}
+
+JSON_Value * json_value_init_boolean(int boolean) : itype(_Ptr<JSON_Value>) {
+    _Ptr<JSON_Value> new_value = json_value_alloc(NULL, JSONBoolean);
     if (!new_value) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONNull;
+    new_value->value.boolean = boolean ? 1 : 0;
     return new_value;
 }
 
+JSON_Value * json_value_init_null(void) : itype(_Ptr<JSON_Value>) {
+    return json_value_alloc(NULL, JSONNull);
+}
+
 JSON_Value * json_value_deep_copy(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Value>) {
     size_t i = 0;
     _Ptr<JSON_Value> return_value = NULL;
@@ -1569,6 +5244,7 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value : itype(_Ptr<const JSO
     _Nt_array_ptr<const char> temp_string = NULL;
     _Nt_array_ptr<const char> temp_key = NULL;
     _Nt_array_ptr<char> temp_string_copy = NULL;
+    size_t temp_string_len = 0;
     _Ptr<JSON_Array> temp_array = NULL;
     _Ptr<JSON_Array> temp_array_copy = NULL;
     _Ptr<JSON_Object> temp_object = NULL;
@@ -1605,7 +5281,7 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value : itype(_Ptr<const JSO
             temp_object_copy = json_value_get_object(return_value);
             for (i = 0; i < json_object_get_count(temp_object); i++) {
                 temp_key = json_object_get_name(temp_object, i);
-                temp_value = json_object_get_value(temp_object, temp_key);
+                temp_value = json_object_get_value_at(temp_object, i);
                 temp_value_copy = json_value_deep_copy(temp_value);
                 if (temp_value_copy == NULL) {
                     json_value_free(return_value);
@@ -1621,17 +5297,26 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value : itype(_Ptr<const JSO
         case JSONBoolean:
             return json_value_init_boolean(json_value_get_boolean(value));
         case JSONNumber:
+            if (value->flags & VALUE_FLAG_INT64) {
+                return json_value_init_int64(value->value.integer);
+            } else if (value->flags & VALUE_FLAG_UINT64) {
+                return json_value_init_uint64(value->value.uinteger);
+            }
             return json_value_init_number(json_value_get_number(value));
         case JSONString:
             temp_string = (_Nt_array_ptr<const char>)json_value_get_string(value);
             if (temp_string == NULL) {
                 return NULL;
             }
+            if (value->flags & VALUE_FLAG_SHORT_STRING) {
+                temp_string_len = strlen(temp_string);
+                return json_value_init_short_string(_Dynamic_bounds_cast<_Nt_array_ptr<const char>>(temp_string, count(temp_string_len)), temp_string_len);
+            }
             temp_string_copy = parson_strdup(temp_string);
             if (temp_string_copy == NULL) {
                 return NULL;
             }
-            return_value = json_value_init_string_no_copy(temp_string_copy);
+            return_value = json_value_init_string_no_copy(temp_string_copy, NULL);
             if (return_value == NULL) {
                 parson_free(char, temp_string_copy);
             }
@@ -1646,127 +5331,128 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value : itype(_Ptr<const JSO
 }
 
 size_t json_serialization_size(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
-    char num_buf _Nt_checked[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so done statically */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 0, num_buf, NULL, 0);
-    return res < 0 ? 0 : (size_t)(res + 1);
+    return json_serialization_size_internal(value, 0);
 }
 
 JSON_Status json_serialize_to_buffer(const JSON_Value *value : itype(_Ptr<const JSON_Value>),  char *buf : itype(_Nt_array_ptr<char>) byte_count(buf_size_in_bytes), size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 0, NULL, buf, buf_size_in_bytes);
-    if (written < 0) {
-        buf[0] = '\0';
-        return JSONFailure;
-    }
-    buf[written] = '\0';
-    return JSONSuccess;
+    return json_serialize_to_buffer_internal(value, buf, buf_size_in_bytes, 0);
 }
 
+JSON_Status json_serialize_to_reusable_buffer(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char **buf : itype(_Ptr<_Nt_array_ptr<char>>), size_t *buf_size : itype(_Ptr<size_t>)) {
+    return json_serialize_to_reusable_buffer_internal(value, buf, buf_size, 0);
+}
 JSON_Status json_serialize_to_file(const JSON_Value *value : itype(_Ptr<const JSON_Value>), const char *filename : itype(_Nt_array_ptr<const char>)) {
-    JSON_Status return_code = JSONSuccess;
-    _Ptr<FILE> fp = NULL;
-    _Nt_array_ptr<char> serialized_string = json_serialize_to_string(value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
-    fp = fopen(filename, "w");
+    return json_serialize_to_file_internal(value, filename, 0);
+}
+
+JSON_Status json_serialize_to_fp(const JSON_Value *value : itype(_Ptr<const JSON_Value>), FILE *fp : itype(_Ptr<FILE>)) {
     if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
         return JSONFailure;
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    json_free_serialized_string(serialized_string);
-    return return_code;
+    return json_serialize_to_callback_internal(value, write_to_file, fp, 0);
+}
+
+JSON_Status json_serialize_to_fd(const JSON_Value *value : itype(_Ptr<const JSON_Value>), int fd) {
+    return json_serialize_to_callback_internal(value, write_to_fd, &fd, 0);
+}
+
+JSON_Status json_serialize_to_callback(const JSON_Value *value : itype(_Ptr<const JSON_Value>),
+                                       _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback,
+                                       void *context : itype(_Ptr<void>)) {
+    return json_serialize_to_callback_internal(value, write_callback, context, 0);
 }
 
 char * json_serialize_to_string(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Nt_array_ptr<char>) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size(value);
-    _Nt_array_ptr<char> buf : byte_count(buf_size_bytes) = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
-    }
-    buf = parson_string_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
-    }
-    serialization_result = json_serialize_to_buffer(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(_Dynamic_bounds_cast<_Nt_array_ptr<char>>(buf, count(0)));
-        return NULL;
-    }
-    return buf;
+    return json_serialize_to_string_internal(value, 0);
 }
 
 size_t json_serialization_size_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) {
-    char num_buf _Nt_checked[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 1, num_buf, NULL, 0);
-    return res < 0 ? 0 : (size_t)(res + 1);
+    return json_serialization_size_internal(value, 1);
 }
 
 JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char *buf : itype(_Nt_array_ptr<char>) byte_count(buf_size_in_bytes), size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size_pretty(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 1, NULL, buf, buf_size_in_bytes);
-    if (written < 0) {
-        buf[0] = '\0';
-        return JSONFailure;
-    }
-    buf[written] = '\0';
-    return JSONSuccess;
+    return json_serialize_to_buffer_internal(value, buf, buf_size_in_bytes, 1);
 }
 
+JSON_Status json_serialize_to_reusable_buffer_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char **buf : itype(_Ptr<_Nt_array_ptr<char>>), size_t *buf_size : itype(_Ptr<size_t>)) {
+    return json_serialize_to_reusable_buffer_internal(value, buf, buf_size, 1);
+}
 JSON_Status json_serialize_to_file_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), const char *filename : itype(_Nt_array_ptr<const char>)) {
-    JSON_Status return_code = JSONSuccess;
-    _Ptr<FILE> fp = NULL;
-    _Nt_array_ptr<char> serialized_string = json_serialize_to_string_pretty(value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
-    fp = fopen(filename, "w");
+    return json_serialize_to_file_internal(value, filename, 1);
+}
+
+JSON_Status json_serialize_to_fp_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), FILE *fp : itype(_Ptr<FILE>)) {
     if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
         return JSONFailure;
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    json_free_serialized_string(serialized_string);
-    return return_code;
+    return json_serialize_to_callback_internal(value, write_to_file, fp, 1);
+}
+
+JSON_Status json_serialize_to_fd_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), int fd) {
+    return json_serialize_to_callback_internal(value, write_to_fd, &fd, 1);
+}
+
+JSON_Status json_serialize_to_callback_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>),
+                                              _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback,
+                                              void *context : itype(_Ptr<void>)) {
+    return json_serialize_to_callback_internal(value, write_callback, context, 1);
 }
 
 char * json_serialize_to_string_pretty(const JSON_Value* value : itype(_Ptr<const JSON_Value>)) : itype(_Nt_array_ptr<char>) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size_pretty(value);
-    _Nt_array_ptr<char> buf : byte_count(buf_size_bytes) = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
+    return json_serialize_to_string_internal(value, 1);
+}
+
+JSON_Serializer * json_serializer_init(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Serializer>) {
+    return json_serializer_init_internal(value, 0);
+}
+
+JSON_Serializer * json_serializer_init_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Serializer>) {
+    return json_serializer_init_internal(value, 1);
+}
+
+/* TODO: Copying out of pending at offset isn't expressible with checked pointers. */
+_Unchecked size_t json_serializer_next(JSON_Serializer *serializer : itype(_Ptr<JSON_Serializer>), char *buf : itype(_Array_ptr<char>) count(len), size_t len) {
+    size_t written = 0, available = 0;
+    if (serializer == NULL || buf == NULL || serializer->failed) {
+        return 0;
     }
-    buf = parson_string_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
+    while (written < len) {
+        available = serializer->pending.length - serializer->pending_offset;
+        if (available == 0) {
+            if (json_serializer_is_done(serializer)) {
+                break;
+            }
+            serializer->pending.length = 0;
+            serializer->pending_offset = 0;
+            if (json_serializer_step(serializer) == JSONFailure) {
+                serializer->failed = 1;
+                return 0;
+            }
+            continue;
+        }
+        if (available > len - written) {
+            available = len - written;
+        }
+        memcpy(buf + written, serializer->pending.buf + serializer->pending_offset, available);
+        serializer->pending_offset += available;
+        written += available;
     }
-    serialization_result = json_serialize_to_buffer_pretty(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(_Dynamic_bounds_cast<_Nt_array_ptr<char>>(buf, count(0)));
-        return NULL;
+    return written;
+}
+
+int json_serializer_is_done(const JSON_Serializer *serializer : itype(_Ptr<const JSON_Serializer>)) {
+    return serializer != NULL && !serializer->failed && serializer->stack_count == 0 &&
+           serializer->next_value == NULL && serializer->string == NULL &&
+           serializer->pending_offset == serializer->pending.length;
+}
+
+void json_serializer_free(JSON_Serializer *serializer : itype(_Ptr<JSON_Serializer>)) {
+    if (serializer == NULL) {
+        return;
     }
-    return buf;
+    parson_free(JSON_Serializer_Frame, serializer->stack);
+    parson_free(char, serializer->pending.buf);
+    parson_free(JSON_Serializer, serializer);
 }
 
 void json_free_serialized_string(char *string : itype(_Nt_array_ptr<char>)) {
@@ -1775,7 +5461,7 @@ void json_free_serialized_string(char *string : itype(_Nt_array_ptr<char>)) {
 
 JSON_Status json_array_remove(JSON_Array *array : itype(_Ptr<JSON_Array>), size_t ix) {
     size_t to_move_bytes = 0;
-    if (array == NULL || ix >= json_array_get_count(array)) {
+    if (array == NULL || ix >= json_array_get_count(array) || json_array_unpack(array) == JSONFailure) {
         return JSONFailure;
     }
     json_value_free(json_array_get_value(array, ix));
@@ -1789,13 +5475,12 @@ JSON_Status json_array_remove(JSON_Array *array : itype(_Ptr<JSON_Array>), size_
 }
 
 JSON_Status json_array_replace_value(JSON_Array *array : itype(_Ptr<JSON_Array>), size_t ix, JSON_Value *value : itype(_Ptr<JSON_Value>)) {
-    if (array == NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array)) {
+    JSON_Array_Cell cell = { ARRAY_CELL_BOXED, 0, { NULL } };
+    if (value == NULL || value->parent != NULL) {
         return JSONFailure;
     }
-    json_value_free(json_array_get_value(array, ix));
-    value->parent = json_array_get_wrapping_value(array);
-    array->items[ix] = value;
-    return JSONSuccess;
+    cell.value.boxed = value;
+    return json_array_replace_cell(array, ix, cell);
 }
 
 JSON_Status json_array_replace_string(JSON_Array *array : itype(_Ptr<JSON_Array>), size_t i, const char* string : itype(_Nt_array_ptr<const char>)) {
@@ -1811,44 +5496,28 @@ JSON_Status json_array_replace_string(JSON_Array *array : itype(_Ptr<JSON_Array>
 }
 
 JSON_Status json_array_replace_number(JSON_Array *array : itype(_Ptr<JSON_Array>), size_t i, double number) {
-    _Ptr<JSON_Value> value = json_value_init_number(number);
-    if (value == NULL) {
-        return JSONFailure;
-    }
-    if (json_array_replace_value(array, i, value) == JSONFailure) {
-        json_value_free(value);
+    JSON_Array_Cell cell = { JSONNumber, 0, { NULL } };
+    if (IS_NUMBER_INVALID(number)) {
         return JSONFailure;
     }
-    return JSONSuccess;
+    cell.value.number = number;
+    return json_array_replace_cell(array, i, cell);
 }
 
 JSON_Status json_array_replace_boolean(JSON_Array *array : itype(_Ptr<JSON_Array>), size_t i, int boolean) {
-    _Ptr<JSON_Value> value = json_value_init_boolean(boolean);
-    if (value == NULL) {
-        return JSONFailure;
-    }
-    if (json_array_replace_value(array, i, value) == JSONFailure) {
-        json_value_free(value);
-        return JSONFailure;
-    }
-    return JSONSuccess;
+    JSON_Array_Cell cell = { JSONBoolean, 0, { NULL } };
+    cell.value.boolean = boolean ? 1 : 0;
+    return json_array_replace_cell(array, i, cell);
 }
 
 JSON_Status json_array_replace_null(JSON_Array *array : itype(_Ptr<JSON_Array>), size_t i) {
-    _Ptr<JSON_Value> value = json_value_init_null();
-    if (value == NULL) {
-        return JSONFailure;
-    }
-    if (json_array_replace_value(array, i, value) == JSONFailure) {
-        json_value_free(value);
-        return JSONFailure;
-    }
-    return JSONSuccess;
+    JSON_Array_Cell cell = { JSONNull, 0, { NULL } };
+    return json_array_replace_cell(array, i, cell);
 }
 
 JSON_Status json_array_clear(JSON_Array *array : itype(_Ptr<JSON_Array>)) {
     size_t i = 0;
-    if (array == NULL) {
+    if (array == NULL || json_array_unpack(array) == JSONFailure) {
         return JSONFailure;
     }
     for (i = 0; i < json_array_get_count(array); i++) {
@@ -1878,39 +5547,50 @@ JSON_Status json_array_append_string(JSON_Array *array : itype(_Ptr<JSON_Array>)
 }
 
 JSON_Status json_array_append_number(JSON_Array *array : itype(_Ptr<JSON_Array>), double number) {
-    _Ptr<JSON_Value> value = json_value_init_number(number);
-    if (value == NULL) {
+    JSON_Array_Cell cell = { JSONNumber, 0, { NULL } };
+    if (array == NULL || IS_NUMBER_INVALID(number)) {
         return JSONFailure;
     }
-    if (json_array_append_value(array, value) == JSONFailure) {
-        json_value_free(value);
+    cell.value.number = number;
+    return json_array_add_cell(array, cell);
+}
+
+JSON_Status json_array_append_int64(JSON_Array *array : itype(_Ptr<JSON_Array>), int64_t number) {
+    JSON_Array_Cell cell = { JSONNumber, VALUE_FLAG_INT64, { NULL } };
+    if (array == NULL) {
         return JSONFailure;
     }
-    return JSONSuccess;
+    cell.value.integer = number;
+    return json_array_add_cell(array, cell);
 }
 
-JSON_Status json_array_append_boolean(JSON_Array *array : itype(_Ptr<JSON_Array>), int boolean) {
-    _Ptr<JSON_Value> value = json_value_init_boolean(boolean);
-    if (value == NULL) {
+JSON_Status json_array_append_uint64(JSON_Array *array : itype(_Ptr<JSON_Array>), uint64_t number) {
+    JSON_Array_Cell cell = { JSONNumber, VALUE_FLAG_UINT64, { NULL } };
+    if (array == NULL) {
         return JSONFailure;
     }
-    if (json_array_append_value(array, value) == JSONFailure) {
-        json_value_free(value);
-        return JSONFailure;
+    if (number <= (uint64_t)INT64_MAX) {
+        return json_array_append_int64(array, (int64_t)number);
     }
-    return JSONSuccess;
+    cell.value.uinteger = number;
+    return json_array_add_cell(array, cell);
 }
 
-JSON_Status json_array_append_null(JSON_Array *array : itype(_Ptr<JSON_Array>)) {
-    _Ptr<JSON_Value> value = json_value_init_null();
-    if (value == NULL) {
+JSON_Status json_array_append_boolean(JSON_Array *array : itype(_Ptr<JSON_Array>), int boolean) {
+    JSON_Array_Cell cell = { JSONBoolean, 0, { NULL } };
+    if (array == NULL) {
         return JSONFailure;
     }
-    if (json_array_append_value(array, value) == JSONFailure) {
-        json_value_free(value);
+    cell.value.boolean = boolean ? 1 : 0;
+    return json_array_add_cell(array, cell);
+}
+
+JSON_Status json_array_append_null(JSON_Array *array : itype(_Ptr<JSON_Array>)) {
+    JSON_Array_Cell cell = { JSONNull, 0, { NULL } };
+    if (array == NULL) {
         return JSONFailure;
     }
-    return JSONSuccess;
+    return json_array_add_cell(array, cell);
 }
 
 JSON_Status json_object_set_value(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), JSON_Value *value : itype(_Ptr<JSON_Value>)) {
@@ -1919,19 +5599,22 @@ JSON_Status json_object_set_value(JSON_Object *object : itype(_Ptr<JSON_Object>)
     if (object == NULL || name == NULL || value == NULL || value->parent != NULL) {
         return JSONFailure;
     }
-    old_value = json_object_get_value(object, name);
-    if (old_value != NULL) { /* free and overwrite old value */
+    size_t name_len = strlen(name);
+    _Nt_array_ptr<const char> name_with_len : count(name_len) = NULL;
+    _Unchecked {
+        name_with_len = _Assume_bounds_cast<_Nt_array_ptr<const char>>(name, count(name_len));
+    }
+    i = json_object_find(object, name_with_len, name_len);
+    if (i != OBJECT_NOT_FOUND) { /* free and overwrite old value */
+        old_value = object->entries[i].value;
         json_value_free(old_value);
-        for (i = 0; i < json_object_get_count(object); i++) {
-            if (strcmp(object->names[i], name) == 0) {
-                value->parent = json_object_get_wrapping_value(object);
-                object->values[i] = value;
-                return JSONSuccess;
-            }
-        }
+        value->parent = json_object_get_wrapping_value(object);
+        json_arena_attach(object->arena, value);
+        object->entries[i].value = value;
+        return JSONSuccess;
     }
     /* add new key value pair */
-    return json_object_add(object, (_Nt_array_ptr<const char>)name, value);
+    return json_object_addn(object, name_with_len, name_len, value);
 }
 
 JSON_Status json_object_set_string(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), const char *string : itype(_Nt_array_ptr<const char>)) {
@@ -1942,6 +5625,14 @@ JSON_Status json_object_set_number(JSON_Object *object : itype(_Ptr<JSON_Object>
     return json_object_set_value(object, name, json_value_init_number(number));
 }
 
+JSON_Status json_object_set_int64(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), int64_t number) {
+    return json_object_set_value(object, name, json_value_init_int64(number));
+}
+
+JSON_Status json_object_set_uint64(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), uint64_t number) {
+    return json_object_set_value(object, name, json_value_init_uint64(number));
+}
+
 JSON_Status json_object_set_boolean(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), int boolean) {
     return json_object_set_value(object, name, json_value_init_boolean(boolean));
 }
@@ -2064,9 +5755,12 @@ JSON_Status json_object_clear(JSON_Object *object : itype(_Ptr<JSON_Object>)) {
         return JSONFailure;
     }
     for (i = 0; i < json_object_get_count(object); i++) {
-        parson_free(char, object->names[i]);
-        json_value_free(object->values[i]);
+        parson_arena_free(object->arena, char, object->entries[i].name);
+        json_value_free(object->entries[i].value);
     }
+    parson_arena_free(object->arena, size_t, object->index);
+    object->index = NULL;
+    object->index_capacity = 0;
     object->count = 0;
     return JSONSuccess;
 }
@@ -2191,6 +5885,13 @@ int json_value_equals(const JSON_Value *a : itype(_Ptr<const JSON_Value>), const
         case JSONBoolean:
             return json_value_get_boolean(a) == json_value_get_boolean(b);
         case JSONNumber:
+            if ((a->flags & VALUE_FLAG_INTEGER) && (b->flags & VALUE_FLAG_INTEGER)) {
+                /* integers are stored as uint64 only above INT64_MAX, so different storage means different numbers */
+                if ((a->flags & VALUE_FLAG_INTEGER) != (b->flags & VALUE_FLAG_INTEGER)) {
+                    return 0;
+                }
+                return (a->flags & VALUE_FLAG_INT64) ? a->value.integer == b->value.integer : a->value.uinteger == b->value.uinteger;
+            }
             return fabs(json_value_get_number(a) - json_value_get_number(b)) < 0.000001; /* EPSILON */
         case JSONError:
             return 1;
@@ -2240,4 +5941,8 @@ void json_set_escape_slashes(int escape_slashes) {
     parson_escape_slashes = escape_slashes;
 }
 
+void json_set_max_nesting(size_t max_nesting) {
+    parson_max_nesting = max_nesting;
+}
+
 #pragma CHECKED_SCOPE pop
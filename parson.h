@@ -36,11 +36,16 @@ extern "C"
 #pragma CHECKED_SCOPE on
 
 #include <stddef.h>   /* size_t */
+#include <stdint.h>   /* int64_t, uint64_t */
+#include <stdio.h>    /* FILE */
 
 /* Types and enums */
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t  JSON_Array;
 typedef struct json_value_t  JSON_Value;
+typedef struct json_serializer_t JSON_Serializer;
+typedef struct json_parser_t JSON_Parser;
+typedef struct json_document_t JSON_Document;
 
 enum json_value_type {
     JSONError   = -1,
@@ -68,6 +73,11 @@ _Itype_for_any(T) void json_set_allocation_functions(_Ptr<void* (size_t s) : ity
  This function sets a global setting and is not thread safe. */
 void json_set_escape_slashes(int escape_slashes);
 
+/* Sets how many arrays and objects a parsed value can be nested in, 1000 by default. Parsing
+ doesn't recurse, so deeper limits only cost heap memory. Deeper documents fail to parse.
+ This function sets a global setting and is not thread safe. */
+void json_set_max_nesting(size_t max_nesting);
+
 /* Parses first JSON value in a file, returns NULL in case of error */
 JSON_Value * json_parse_file(const char *filename : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>);
 
@@ -82,17 +92,113 @@ JSON_Value * json_parse_string(const char *string : itype(_Nt_array_ptr<const ch
     returns NULL in case of error */
 JSON_Value * json_parse_string_with_comments(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>);
 
+/*  Parses first JSON value in the first len bytes of buf, which doesn't have to be null terminated.
+    Returns NULL in case of error. */
+JSON_Value * json_parse_buffer(const char *buf : itype(_Array_ptr<const char>) count(len), size_t len) : itype(_Ptr<JSON_Value>);
+
+/*  Same as json_parse_buffer, but ignores comments (/ * * / and //) */
+JSON_Value * json_parse_buffer_with_comments(const char *buf : itype(_Array_ptr<const char>) count(len), size_t len) : itype(_Ptr<JSON_Value>);
+
+/*  Parses first JSON value in a string into a single arena, returns NULL in case of error.
+    Freeing the returned root with json_value_free releases the whole document at once,
+    values and containers of the document otherwise behave as usual. */
+JSON_Value * json_parse_string_arena(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>);
+
+/*  Parses first JSON value in a string in place, returns NULL in case of error. Takes ownership of
+    the string, which has to be allocated with the malloc function set by json_set_allocation_functions
+    and is freed together with the returned root, or right away if parsing fails. Strings and names
+    of the document point into the string, otherwise it's the same as json_parse_string_arena. */
+JSON_Value * json_parse_string_in_situ(char *string : itype(_Nt_array_ptr<char>)) : itype(_Ptr<JSON_Value>);
+
+/* Parses first JSON value in a file in place, see json_parse_string_in_situ */
+JSON_Value * json_parse_file_in_situ(const char *filename : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>);
+
+/*  Incremental parsing of a document that arrives in chunks, e.g. from a socket. Chunks don't have to
+    be null terminated and may split the document anywhere. json_parser_feed returns JSONFailure as
+    soon as the input can't be valid JSON, further feeding fails as well. json_parser_finish ends the
+    input, frees the parser and returns the first JSON value or NULL in case of error. */
+JSON_Parser * json_parser_init(void) : itype(_Ptr<JSON_Parser>);
+JSON_Status   json_parser_feed(JSON_Parser *parser : itype(_Ptr<JSON_Parser>), const char *chunk : itype(_Array_ptr<const char>) count(len), size_t len);
+JSON_Value  * json_parser_finish(JSON_Parser *parser : itype(_Ptr<JSON_Parser>)) : itype(_Ptr<JSON_Value>);
+
+/*  Callbacks of event-driven parsing. Any of them may be NULL, returning JSONFailure stops parsing.
+    Names and strings aren't null terminated, they point either into the parsed string or into
+    a buffer that is reused for the next escaped string. */
+typedef struct json_sax_callbacks_t {
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>))> start_object;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>))> end_object;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>))> start_array;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>))> end_array;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>), const char *key : itype(_Array_ptr<const char>) count(len), size_t len)> key;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>), const char *string : itype(_Array_ptr<const char>) count(len), size_t len)> string;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>), double number)> number;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>), int boolean)> boolean;
+    _Ptr<JSON_Status (void *context : itype(_Ptr<void>))> null;
+} JSON_Sax_Callbacks;
+
+/*  Parses first JSON value in a string and reports it to callbacks instead of building a tree,
+    no memory is allocated per value. Duplicate names are reported as they are. Returns JSONFailure
+    if the string isn't valid JSON or a callback failed. */
+JSON_Status json_parse_string_sax(const char *string : itype(_Nt_array_ptr<const char>),
+                                  const JSON_Sax_Callbacks *callbacks : itype(_Ptr<const JSON_Sax_Callbacks>),
+                                  void *context : itype(_Ptr<void>));
+
+/*  Lazy parsing for documents of which only a few values are needed. Parsing only records where
+    values and names are, a value is decoded when it's accessed for the first time. Only structure
+    is validated up front, strings and numbers are checked when they're decoded and accessors return
+    NULL (or 0) if they're invalid. Names are looked up in the root object, with dotget in nested
+    objects too, duplicate names return the first value. Returned values are owned by the document
+    and freed with it, parsed string is copied. */
+JSON_Document * json_document_parse(const char *string : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Document>);
+JSON_Value_Type json_document_get_type(const JSON_Document *document : itype(_Ptr<const JSON_Document>));
+JSON_Value    * json_document_get_value(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>);
+JSON_Value    * json_document_dotget_value(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Value>);
+const char    * json_document_dotget_string(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Nt_array_ptr<const char>);
+double          json_document_dotget_number(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>));
+int             json_document_dotget_boolean(JSON_Document *document : itype(_Ptr<JSON_Document>), const char *name : itype(_Nt_array_ptr<const char>));
+void            json_document_free(JSON_Document *document : itype(_Ptr<JSON_Document>));
+
 /* Serialization */
 size_t      json_serialization_size(const JSON_Value *value : itype(_Ptr<const JSON_Value>)); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char *buf : itype(_Nt_array_ptr<char>) byte_count(buf_size_in_bytes), size_t buf_size_in_bytes);
 JSON_Status json_serialize_to_file(const JSON_Value *value : itype(_Ptr<const JSON_Value>), const char *filename : itype(_Nt_array_ptr<const char>));
 char *      json_serialize_to_string(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Nt_array_ptr<char>);
 
+/* Serializes into *buf of *buf_size bytes, reallocating it if it's too small, so the same buffer
+ * can be reused for many values without sizing them first. *buf can be NULL initially and has to
+ * be freed with json_free_serialized_string. */
+JSON_Status json_serialize_to_reusable_buffer(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char **buf : itype(_Ptr<_Nt_array_ptr<char>>), size_t *buf_size : itype(_Ptr<size_t>));
+
+/* Streaming serialization, output is written in small chunks as it's produced instead of being
+ * built in memory first. write_callback should return number of written bytes, anything other
+ * than len is treated as failure. json_serialize_to_file uses these as well. */
+JSON_Status json_serialize_to_fp(const JSON_Value *value : itype(_Ptr<const JSON_Value>), FILE *fp : itype(_Ptr<FILE>));
+JSON_Status json_serialize_to_fd(const JSON_Value *value : itype(_Ptr<const JSON_Value>), int fd);
+JSON_Status json_serialize_to_callback(const JSON_Value *value : itype(_Ptr<const JSON_Value>),
+                                       _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback,
+                                       void *context : itype(_Ptr<void>));
+
 /* Pretty serialization */
 size_t      json_serialization_size_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>)); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char *buf : itype(_Nt_array_ptr<char>) byte_count(buf_size_in_bytes), size_t buf_size_in_bytes);
 JSON_Status json_serialize_to_file_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), const char *filename : itype(_Nt_array_ptr<const char>));
 char *      json_serialize_to_string_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Nt_array_ptr<char>);
+JSON_Status json_serialize_to_reusable_buffer_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), char **buf : itype(_Ptr<_Nt_array_ptr<char>>), size_t *buf_size : itype(_Ptr<size_t>));
+JSON_Status json_serialize_to_fp_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), FILE *fp : itype(_Ptr<FILE>));
+JSON_Status json_serialize_to_fd_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>), int fd);
+JSON_Status json_serialize_to_callback_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>),
+                                              _Ptr<size_t (void *context : itype(_Ptr<void>), const char *data : itype(_Array_ptr<const char>) count(len), size_t len)> write_callback,
+                                              void *context : itype(_Ptr<void>));
+
+/* Incremental serialization for non-blocking output. json_serializer_next fills buf with up to len
+ * next bytes of output (not null terminated) and returns their number, 0 means the whole value was
+ * written or serialization failed (json_serializer_is_done tells which). Serialized value must not
+ * be modified until the serializer is freed. */
+JSON_Serializer * json_serializer_init(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Serializer>);
+JSON_Serializer * json_serializer_init_pretty(const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Serializer>);
+size_t            json_serializer_next(JSON_Serializer *serializer : itype(_Ptr<JSON_Serializer>), char *buf : itype(_Array_ptr<char>) count(len), size_t len);
+int               json_serializer_is_done(const JSON_Serializer *serializer : itype(_Ptr<const JSON_Serializer>));
+void              json_serializer_free(JSON_Serializer *serializer : itype(_Ptr<JSON_Serializer>));
 
 void        json_free_serialized_string(char *string : itype(_Nt_array_ptr<char>)); /* frees string from json_serialize_to_string and json_serialize_to_string_pretty */
 
@@ -119,6 +225,8 @@ const char  * json_object_get_string (const JSON_Object *object : itype(_Ptr<con
 JSON_Object * json_object_get_object (const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Object>);
 JSON_Array  * json_object_get_array  (const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)) : itype(_Ptr<JSON_Array>);
 double        json_object_get_number (const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)); /* returns 0 on fail */
+int64_t       json_object_get_int64  (const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)); /* returns 0 on fail */
+uint64_t      json_object_get_uint64 (const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)); /* returns 0 on fail */
 int           json_object_get_boolean(const JSON_Object *object : itype(_Ptr<const JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>)); /* returns -1 on fail */
 
 /* dotget functions enable addressing values with dot notation in nested objects,
@@ -151,6 +259,8 @@ int json_object_dothas_value_of_type(const JSON_Object *object : itype(_Ptr<cons
 JSON_Status json_object_set_value(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), JSON_Value *value : itype(_Ptr<JSON_Value>));
 JSON_Status json_object_set_string(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), const char *string : itype(_Nt_array_ptr<const char>));
 JSON_Status json_object_set_number(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), double number);
+JSON_Status json_object_set_int64(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), int64_t number);
+JSON_Status json_object_set_uint64(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), uint64_t number);
 JSON_Status json_object_set_boolean(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>), int boolean);
 JSON_Status json_object_set_null(JSON_Object *object : itype(_Ptr<JSON_Object>), const char *name : itype(_Nt_array_ptr<const char>));
 
@@ -179,7 +289,12 @@ const char  * json_array_get_string (const JSON_Array *array : itype(_Ptr<const
 JSON_Object * json_array_get_object (const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index) : itype(_Ptr<JSON_Object>);
 JSON_Array  * json_array_get_array  (const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index) : itype(_Ptr<JSON_Array>);
 double        json_array_get_number (const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index); /* returns 0 on fail */
+int64_t       json_array_get_int64  (const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index); /* returns 0 on fail */
+uint64_t      json_array_get_uint64 (const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index); /* returns 0 on fail */
 int           json_array_get_boolean(const JSON_Array *array : itype(_Ptr<const JSON_Array>), size_t index); /* returns -1 on fail */
+/* Copies numbers of the first n items to out, stops at the first item that isn't a number.
+ * Returns how many numbers were copied. */
+size_t        json_array_get_numbers(const JSON_Array *array : itype(_Ptr<const JSON_Array>), double *out : itype(_Array_ptr<double>) count(n), size_t n);
 size_t        json_array_get_count  (const JSON_Array *array : itype(_Ptr<const JSON_Array>));
 JSON_Value  * json_array_get_wrapping_value(const JSON_Array *array : itype(_Ptr<const JSON_Array>)) : itype(_Ptr<JSON_Value>);
 
@@ -204,6 +319,8 @@ JSON_Status json_array_clear(JSON_Array *array : itype(_Ptr<JSON_Array>));
 JSON_Status json_array_append_value(JSON_Array *array : itype(_Ptr<JSON_Array>), JSON_Value *value : itype(_Ptr<JSON_Value>));
 JSON_Status json_array_append_string(JSON_Array *array : itype(_Ptr<JSON_Array>), const char *string : itype(_Nt_array_ptr<const char>));
 JSON_Status json_array_append_number(JSON_Array *array : itype(_Ptr<JSON_Array>), double number);
+JSON_Status json_array_append_int64(JSON_Array *array : itype(_Ptr<JSON_Array>), int64_t number);
+JSON_Status json_array_append_uint64(JSON_Array *array : itype(_Ptr<JSON_Array>), uint64_t number);
 JSON_Status json_array_append_boolean(JSON_Array *array : itype(_Ptr<JSON_Array>), int boolean);
 JSON_Status json_array_append_null(JSON_Array *array : itype(_Ptr<JSON_Array>));
 
@@ -214,16 +331,25 @@ JSON_Value * json_value_init_object (void)
 JSON_Value * json_value_init_array  (void)                                                    : itype(_Ptr<JSON_Value>);
 JSON_Value * json_value_init_string (const char *string : itype(_Nt_array_ptr<const char>))   : itype(_Ptr<JSON_Value>); /* copies passed string */
 JSON_Value * json_value_init_number (double number)                                           : itype(_Ptr<JSON_Value>);
+JSON_Value * json_value_init_int64  (int64_t number)                                          : itype(_Ptr<JSON_Value>);
+JSON_Value * json_value_init_uint64 (uint64_t number)                                         : itype(_Ptr<JSON_Value>);
 JSON_Value * json_value_init_boolean(int boolean)                                             : itype(_Ptr<JSON_Value>);
 JSON_Value * json_value_init_null   (void)                                                    : itype(_Ptr<JSON_Value>);
 JSON_Value * json_value_deep_copy   (const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Value>);
 void         json_value_free        (JSON_Value *value : itype(_Ptr<JSON_Value>));
 
+/* Numbers without fraction and exponent that fit in int64_t or uint64_t are parsed and stored
+ * as integers, so they don't lose precision and json_value_is_integer returns 1 for them.
+ * json_value_get_int64 and json_value_get_uint64 return 0 if number is out of range, other
+ * numbers are truncated. */
 JSON_Value_Type json_value_get_type   (const JSON_Value *value : itype(_Ptr<const JSON_Value>));
 JSON_Object *   json_value_get_object (const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Object>);
 JSON_Array  *   json_value_get_array  (const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Array>);
 const char  *   json_value_get_string (const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Nt_array_ptr<const char>);
 double          json_value_get_number (const JSON_Value *value : itype(_Ptr<const JSON_Value>));
+int64_t         json_value_get_int64  (const JSON_Value *value : itype(_Ptr<const JSON_Value>));
+uint64_t        json_value_get_uint64 (const JSON_Value *value : itype(_Ptr<const JSON_Value>));
+int             json_value_is_integer (const JSON_Value *value : itype(_Ptr<const JSON_Value>));
 int             json_value_get_boolean(const JSON_Value *value : itype(_Ptr<const JSON_Value>));
 JSON_Value  *   json_value_get_parent (const JSON_Value *value : itype(_Ptr<const JSON_Value>)) : itype(_Ptr<JSON_Value>);
 
@@ -27,6 +27,10 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L /* for fileno */
+#endif
+
 #include "parson.h"
 
 #include <stdio_checked.h>
@@ -53,6 +57,18 @@ void test_suite_8(void); /* Test serialization */
 void test_suite_9(void); /* Test serialization (pretty) */
 void test_suite_10(void); /* Testing for memory leaks */
 void test_suite_11(void); /* Additional things that require testing */
+void test_suite_12(void); /* Test objects big enough to be indexed */
+void test_suite_13(void); /* Test documents parsed into an arena */
+void test_suite_14(void); /* Test in-situ parsing */
+void test_suite_15(void); /* Test 64-bit integers */
+void test_suite_16(void); /* Test push parser */
+void test_suite_17(void); /* Test event parsing */
+void test_suite_18(void); /* Test lazily parsed documents */
+void test_suite_19(void); /* Test parsing length-bounded buffers */
+void test_suite_20(void); /* Test runtime nesting limit */
+void test_suite_21(void); /* Test nulls, booleans and numbers stored with their array */
+void test_suite_22(void); /* Test serialization into reusable buffers */
+void test_suite_23(void); /* Test streaming serialization */
 
 void print_commits_info(const char *username, const char *repo);
 void persistence_example(void);
@@ -85,6 +101,18 @@ int main() {
     test_suite_9();
     test_suite_10();
     test_suite_11();
+    test_suite_12();
+    test_suite_13();
+    test_suite_14();
+    test_suite_15();
+    test_suite_16();
+    test_suite_17();
+    test_suite_18();
+    test_suite_19();
+    test_suite_20();
+    test_suite_21();
+    test_suite_22();
+    test_suite_23();
 
     printf("Tests failed: %d\n", tests_failed);
     printf("Tests passed: %d\n", tests_passed);
@@ -118,6 +146,8 @@ void test_suite_1(void) {
     TEST(json_value_equals(json_parse_string(json_serialize_to_string(val)), val));
     TEST(json_value_equals(json_parse_string(json_serialize_to_string_pretty(val)), val));
     if (val) { json_value_free(val); }
+
+    TEST(json_parse_file("tests/not_existing.txt") == NULL);
 }
 
 void test_suite_2(JSON_Value *root_value) {
@@ -254,12 +284,23 @@ void test_suite_3(void) {
     TEST(json_parse_string("false") != NULL);
     TEST(json_parse_string("\"string\"") != NULL);
     TEST(json_parse_string("123") != NULL);
+    TEST(json_parse_string(" \r\n\t{ \"lorem\" :\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\"ipsum\"\r\n}") != NULL);
+
+    puts("Test number parsing:");
+    TEST(json_value_get_number(json_parse_string("0.1")) == 0.1);
+    TEST(json_value_get_number(json_parse_string("-1e-7")) == -1e-7);
+    TEST(json_value_get_number(json_parse_string("123456789012345678")) == 123456789012345678.0);
+    TEST(json_value_get_number(json_parse_string("2.2250738585072014e-308")) == strtod("2.2250738585072014e-308", NULL));
+    TEST(json_value_get_number(json_parse_string("1.00000000000000011102230246251565404236316680908203125")) == 1.0); /* halfway, rounds to even */
+    TEST(json_value_get_number(json_parse_string("0.000000000000000000000000000000001e33")) == 1.0);
 
     puts("Test UTF-16 parsing:");
     TEST(STREQ(json_string(json_parse_string("\"\\u0024x\"")), "$x"));
     TEST(STREQ(json_string(json_parse_string("\"\\u00A2x\"")), "¢x"));
     TEST(STREQ(json_string(json_parse_string("\"\\u20ACx\"")), "€x"));
     TEST(STREQ(json_string(json_parse_string("\"\\uD801\\uDC37x\"")), "𐐷x"));
+    TEST(STREQ(json_string(json_parse_string("\"0123456789abcdef0123456789abcdef\\n0123456789abcdef\\uD801\\uDC37\\\"\"")),
+               "0123456789abcdef0123456789abcdef\n0123456789abcdef𐐷\""));
 
     puts("Testing invalid strings:");
     malloc_count = 0;
@@ -283,6 +324,8 @@ void test_suite_3(void) {
     TEST(json_parse_string("{:\"no name\"}") == NULL);
     TEST(json_parse_string("[,\"no first value\"]") == NULL);
     TEST(json_parse_string("{\"key\"\"value\"}") == NULL);
+    TEST(json_parse_string("[\v1]") == NULL); /* not JSON whitespace */
+    TEST(json_parse_string("[1\f]") == NULL); /* not JSON whitespace */
     TEST(json_parse_string("{\"a\"}") == NULL);
     TEST(json_parse_string("[\"\\u00zz\"]") == NULL); /* invalid utf value */
     TEST(json_parse_string("[\"\\u00\"]") == NULL); /* invalid utf value */
@@ -304,9 +347,27 @@ void test_suite_3(void) {
     TEST(json_parse_string("[-07]") == NULL);
     TEST(json_parse_string("[-007]") == NULL);
     TEST(json_parse_string("[-07.0]") == NULL);
+    TEST(json_parse_string("04") == NULL);
+    TEST(json_parse_string("-01") == NULL);
+    TEST(json_parse_string("0x10") == NULL);
     TEST(json_parse_string("[\"\\uDF67\\uD834\"]") == NULL); /* wrong order surrogate pair */
     TEST(json_parse_string("[1.7976931348623157e309]") == NULL);
     TEST(json_parse_string("[-1.7976931348623157e309]") == NULL);
+    TEST(json_parse_string("[1.]") == NULL);
+    TEST(json_parse_string("[.5]") == NULL);
+    TEST(json_parse_string("[-]") == NULL);
+    TEST(json_parse_string("[+1]") == NULL);
+    TEST(json_parse_string("[1e]") == NULL);
+    TEST(json_parse_string_with_comments("[1, /* 2 */ 3 // 4\n]") != NULL);
+    TEST(json_parse_string_with_comments("[\"/* not a comment */\"]") != NULL);
+    TEST(json_parse_string_with_comments("[1, /* 2]") == NULL);
+    TEST(json_parse_string_with_comments("[1 / 2]") == NULL);
+    /* like json_parse_string, only the first value is parsed */
+    TEST(json_boolean(json_parse_string_with_comments("trueu")) == 1);
+    TEST(json_number(json_parse_string_with_comments("1.5.3")) == 1.5);
+    TEST(json_number(json_parse_string_with_comments("-86-8")) == -86);
+    TEST(json_number(json_parse_string_with_comments("/* a */ 7 // b")) == 7);
+    TEST(json_parse_string_with_comments("[trueu]") == NULL);
     TEST(malloc_count == 0);
 }
 
@@ -488,6 +549,7 @@ void test_suite_8(void) {
     JSON_Value *a = NULL;
     JSON_Value *b = NULL;
     char *buf = NULL;
+    char *exact_buf = NULL;
     size_t serialization_size = 0;
     a = json_parse_file(filename);
     TEST(json_serialize_to_file(a, temp_filename) == JSONSuccess);
@@ -497,6 +559,56 @@ void test_suite_8(void) {
     serialization_size = json_serialization_size(a);
     buf = json_serialize_to_string(a);
     TEST((strlen(buf)+1) == serialization_size);
+    exact_buf = (char*)malloc(serialization_size);
+    TEST(json_serialize_to_buffer(a, exact_buf, serialization_size) == JSONSuccess);
+    TEST(STREQ(exact_buf, buf));
+    TEST(json_serialize_to_buffer(a, exact_buf, serialization_size - 1) == JSONFailure);
+    free(exact_buf);
+    b = json_parse_string("[1.5, -2, \"a\", true, null, {\"n\": 18446744073709551615}]");
+    exact_buf = (char*)malloc(json_serialization_size(b));
+    TEST(json_serialize_to_buffer(b, exact_buf, json_serialization_size(b)) == JSONSuccess);
+    TEST(STREQ(exact_buf, "[1.5,-2,\"a\",true,null,{\"n\":18446744073709551615}]"));
+    free(exact_buf);
+    b = json_parse_string("1.5");
+    exact_buf = (char*)malloc(json_serialization_size(b));
+    TEST(json_serialize_to_buffer(b, exact_buf, json_serialization_size(b)) == JSONSuccess);
+    TEST(STREQ(exact_buf, "1.5"));
+    free(exact_buf);
+
+    a = json_parse_string("[0.1, 1e-7, 0.0001, 1e16, 1e17, 123.456, -2.5, 1e300, 0.30000000000000004]");
+    buf = json_serialize_to_string(a);
+    TEST(STREQ(buf, "[0.1,1e-07,0.0001,10000000000000000,1e+17,123.456,-2.5,1e+300,0.30000000000000004]"));
+    TEST(json_value_equals(a, json_parse_string(buf)));
+}
+
+static size_t append_to_string(void *context, const char *data, size_t len) {
+    strncat((char*)context, data, len);
+    return len;
+}
+
+static size_t fail_writing(void *context, const char *data, size_t len) {
+    (void)context; (void)data; (void)len;
+    return 0;
+}
+
+static char * serialize_in_chunks(JSON_Value *value, int is_pretty, size_t chunk_size) {
+    JSON_Serializer *serializer = is_pretty ? json_serializer_init_pretty(value) : json_serializer_init(value);
+    size_t capacity = chunk_size + 1, length = 0, written = 0;
+    char *output = (char*)malloc(capacity);
+    while ((written = json_serializer_next(serializer, output + length, chunk_size)) > 0) {
+        length += written;
+        if (capacity - length <= chunk_size) {
+            capacity = capacity * 2 + chunk_size;
+            output = (char*)realloc(output, capacity);
+        }
+    }
+    output[length] = '\0';
+    if (!json_serializer_is_done(serializer)) {
+        free(output);
+        output = NULL;
+    }
+    json_serializer_free(serializer);
+    return output;
 }
 
 void test_suite_9(void) {
@@ -560,6 +672,582 @@ void test_suite_11() {
     json_set_escape_slashes(1);
     serialized = json_serialize_to_string(value);
     TEST(STREQ(array_with_escaped_slashes, serialized));
+    json_value_free(value);
+
+    /* strings short enough to be stored in the value itself */
+    value = json_parse_string("[\"\", \"abcdefg\", \"abcdefgh\", \"\\u00e9\\t\"]");
+    TEST(STREQ(json_array_get_string(json_array(value), 0), ""));
+    TEST(STREQ(json_array_get_string(json_array(value), 1), "abcdefg"));
+    TEST(STREQ(json_array_get_string(json_array(value), 2), "abcdefgh"));
+    TEST(STREQ(json_array_get_string(json_array(value), 3), "\xc3\xa9\t"));
+    TEST(json_value_equals(json_value_deep_copy(value), value));
+    TEST(json_value_equals(json_parse_string_arena("[\"\", \"abcdefg\", \"abcdefgh\", \"\\u00e9\\t\"]"), value));
+    TEST(STREQ(json_value_get_string(json_value_init_string("1234567")), "1234567"));
+    json_value_free(value);
+
+    /* parsed containers keep their children inline and move them out when they grow */
+    value = json_parse_string("{\"a\": [1, 2], \"b\": {}, \"c\": []}");
+    TEST(json_array_append_number(json_object_get_array(json_object(value), "a"), 3) == JSONSuccess);
+    TEST(json_object_set_number(json_object_get_object(json_object(value), "b"), "x", 1) == JSONSuccess);
+    TEST(json_array_append_null(json_object_get_array(json_object(value), "c")) == JSONSuccess);
+    TEST(json_object_set_boolean(json_object(value), "d", 1) == JSONSuccess);
+    TEST(json_array_remove(json_object_get_array(json_object(value), "a"), 0) == JSONSuccess);
+    serialized = json_serialize_to_string(value);
+    TEST(STREQ(serialized, "{\"a\":[2,3],\"b\":{\"x\":1},\"c\":[null],\"d\":true}"));
+    json_free_serialized_string(serialized);
+    json_value_free(value);
+}
+
+void test_suite_12(void) {
+    JSON_Value *val = json_value_init_object();
+    JSON_Object *obj = json_value_get_object(val);
+    JSON_Value *parsed = NULL;
+    char name[32];
+    char *serialized = NULL;
+    int i, found = 1, ordered = 1;
+    for (i = 0; i < 1000; i++) {
+        sprintf(name, "key%d", i);
+        json_object_set_number(obj, name, i);
+    }
+    TEST(json_object_get_count(obj) == 1000);
+    for (i = 0; i < 1000; i++) {
+        sprintf(name, "key%d", i);
+        found = found && json_object_get_number(obj, name) == i;
+        ordered = ordered && json_object_get_name(obj, i) != NULL && strcmp(json_object_get_name(obj, i), name) == 0;
+    }
+    TEST(found);
+    TEST(ordered);
+    TEST(json_object_get_value(obj, "key1000") == NULL);
+    TEST(json_object_set_string(obj, "key500", "replaced") == JSONSuccess);
+    TEST(STREQ(json_object_get_string(obj, "key500"), "replaced"));
+    TEST(json_object_get_count(obj) == 1000);
+    for (i = 0; i < 1000; i += 2) {
+        sprintf(name, "key%d", i);
+        json_object_remove(obj, name);
+    }
+    TEST(json_object_get_count(obj) == 500);
+    found = 1;
+    for (i = 0; i < 1000; i++) {
+        sprintf(name, "key%d", i);
+        found = found && json_object_has_value(obj, name) == (i % 2);
+    }
+    TEST(found);
+    TEST(json_object_remove(obj, "key0") == JSONFailure);
+    serialized = json_serialize_to_string(val);
+    TEST(json_value_equals(json_parse_string(serialized), val));
+    TEST(json_value_equals(json_value_deep_copy(val), val));
+    /* parsed objects are allocated at their final size and still grow */
+    parsed = json_parse_string(serialized);
+    TEST(json_object_set_number(json_object(parsed), "new key", 1) == JSONSuccess);
+    TEST(json_object_get_number(json_object(parsed), "key999") == 999);
+    TEST(json_object_get_number(json_object(parsed), "new key") == 1);
+    json_value_free(parsed);
+    json_free_serialized_string(serialized);
+    TEST(json_object_clear(obj) == JSONSuccess);
+    TEST(json_object_get_value(obj, "key1") == NULL);
+    TEST(json_object_set_null(obj, "key1") == JSONSuccess);
+    TEST(json_object_has_value_of_type(obj, "key1", JSONNull));
+    json_value_free(val);
+
+    /* duplicate names are found after the index is built */
+    TEST(json_parse_string("{\"a\":0,\"b\":0,\"c\":0,\"d\":0,\"e\":0,\"f\":0,\"g\":0,\"h\":0,"
+                           "\"i\":0,\"j\":0,\"k\":0,\"l\":0,\"m\":0,\"n\":0,\"o\":0,\"p\":0,"
+                           "\"q\":0,\"r\":0,\"a\":1}") == NULL);
+}
+
+void test_suite_13(void) {
+    char *file_contents = read_file("tests/test_2.txt");
+    JSON_Value *root_value = json_parse_string_arena(file_contents);
+    JSON_Value *other_value = NULL;
+    JSON_Object *root_object = NULL;
+    JSON_Array *array = NULL;
+    char name[32];
+    int i, found = 1;
+    test_suite_2(root_value);
+    TEST(json_value_equals(root_value, json_parse_string(file_contents)));
+    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string(root_value))));
+    TEST(json_value_equals(root_value, json_value_deep_copy(root_value)));
+    json_value_free(root_value);
+
+    /* documents can be modified like any other value */
+    root_value = json_parse_string_arena("{\"string\":\"lorem\",\"array\":[1,2,3],\"object\":{\"a\":true}}");
+    root_object = json_value_get_object(root_value);
+    array = json_object_get_array(root_object, "array");
+    TEST(json_value_get_parent(json_object_get_value(root_object, "string")) == root_value);
+    TEST(json_object_get_wrapping_value(root_object) == root_value);
+    TEST(json_object_set_string(root_object, "string", "ipsum") == JSONSuccess);
+    TEST(STREQ(json_object_get_string(root_object, "string"), "ipsum"));
+    TEST(json_array_append_string(array, "appended") == JSONSuccess);
+    TEST(json_array_replace_number(array, 0, 42) == JSONSuccess);
+    TEST(json_array_remove(array, 1) == JSONSuccess);
+    TEST(json_array_get_count(array) == 3);
+    TEST(json_object_dotset_number(root_object, "object.nested.number", 1) == JSONSuccess);
+    TEST(json_object_dotremove(root_object, "object.a") == JSONSuccess);
+    for (i = 0; i < 100; i++) {
+        sprintf(name, "key%d", i);
+        json_object_set_number(root_object, name, i);
+    }
+    for (i = 0; i < 100; i++) {
+        sprintf(name, "key%d", i);
+        found = found && json_object_get_number(root_object, name) == i;
+    }
+    TEST(found);
+    other_value = json_parse_string_arena("[\"other\",{\"document\":null}]");
+    TEST(json_object_set_value(root_object, "other", other_value) == JSONSuccess);
+    other_value = json_parse_string_arena("\"yet another document\"");
+    TEST(json_array_append_value(array, other_value) == JSONSuccess);
+    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string(root_value))));
+    TEST(json_object_remove(root_object, "object") == JSONSuccess);
+    TEST(json_object_clear(json_value_get_object(json_array_get_value(json_object_get_array(root_object, "other"), 1))) == JSONSuccess);
+    json_value_free(root_value);
+
+    TEST(json_parse_string_arena("{\"a\":[1,2,}") == NULL);
+    TEST(json_parse_string_arena(NULL) == NULL);
+}
+
+void test_suite_14(void) {
+    char *file_contents = read_file("tests/test_2.txt");
+    char *buffer = NULL;
+    const char *string = NULL;
+    JSON_Value *root_value = json_parse_file_in_situ("tests/test_2.txt");
+    JSON_Object *root_object = NULL;
+    test_suite_2(root_value);
+    TEST(json_value_equals(root_value, json_parse_string(file_contents)));
+    json_value_free(root_value);
+
+    buffer = (char*)malloc(strlen(file_contents) + 1);
+    strcpy(buffer, file_contents);
+    root_value = json_parse_string_in_situ(buffer);
+    test_suite_2(root_value);
+    root_object = json_value_get_object(root_value);
+    string = json_object_get_string(root_object, "string");
+    TEST(string > buffer && string < buffer + strlen(file_contents));
+    string = json_object_get_string(root_object, "surrogate string");
+    TEST(string > buffer && string < buffer + strlen(file_contents));
+    TEST(json_object_set_string(root_object, "string", "ipsum") == JSONSuccess);
+    TEST(json_object_set_string(root_object, "new string", "dolor") == JSONSuccess);
+    TEST(json_value_equals(root_value, json_parse_string(json_serialize_to_string(root_value))));
+    json_value_free(root_value);
+
+    buffer = (char*)malloc(16);
+    strcpy(buffer, "[\"a\\u0062c\",]");
+    TEST(json_parse_string_in_situ(buffer) == NULL);
+    TEST(json_parse_string_in_situ(NULL) == NULL);
+    TEST(json_parse_file_in_situ("tests/not_existing.txt") == NULL);
+}
+
+void test_suite_15(void) {
+    JSON_Value *root_value = json_parse_string("[9007199254740993, -9223372036854775808, 18446744073709551615, 1.0, 1e2, -0, 18446744073709551616]");
+    JSON_Array *array = json_value_get_array(root_value);
+    char *serialized = NULL;
+    TEST(json_value_is_integer(json_array_get_value(array, 0)));
+    TEST(json_array_get_int64(array, 0) == 9007199254740993LL);
+    TEST(json_array_get_int64(array, 1) == INT64_MIN);
+    TEST(json_array_get_uint64(array, 1) == 0); /* out of range */
+    TEST(json_array_get_uint64(array, 2) == UINT64_MAX);
+    TEST(json_array_get_int64(array, 2) == 0); /* out of range */
+    TEST(json_array_get_number(array, 2) == 18446744073709551615.0);
+    TEST(!json_value_is_integer(json_array_get_value(array, 3)));
+    TEST(json_array_get_int64(array, 3) == 1);
+    TEST(!json_value_is_integer(json_array_get_value(array, 4)));
+    TEST(!json_value_is_integer(json_array_get_value(array, 5)));
+    TEST(!json_value_is_integer(json_array_get_value(array, 6)));
+    serialized = json_serialize_to_string(root_value);
+    TEST(STREQ(serialized, "[9007199254740993,-9223372036854775808,18446744073709551615,1,100,-0,1.8446744073709552e+19]"));
+    json_free_serialized_string(serialized);
+    TEST(json_value_equals(root_value, json_value_deep_copy(root_value)));
+    TEST(json_array_append_int64(array, -42) == JSONSuccess);
+    TEST(json_array_append_uint64(array, 42) == JSONSuccess);
+    TEST(json_value_equals(json_array_get_value(array, 8), json_parse_string("42")));
+    TEST(!json_value_equals(json_array_get_value(array, 0), json_parse_string("9007199254740992")));
+    TEST(json_value_get_int64(json_array_get_value(array, 7)) == -42);
+    json_value_free(root_value);
+}
+
+static JSON_Value * parse_in_chunks(const char *string, size_t chunk_size) {
+    JSON_Parser *parser = json_parser_init();
+    size_t len = strlen(string), offset = 0;
+    for (offset = 0; offset < len; offset += chunk_size) {
+        if (json_parser_feed(parser, string + offset, len - offset < chunk_size ? len - offset : chunk_size) == JSONFailure) {
+            break;
+        }
+    }
+    return json_parser_finish(parser);
+}
+
+void test_suite_16(void) {
+    char *file_contents = read_file("tests/test_2.txt");
+    JSON_Value *expected = json_parse_string(file_contents);
+    JSON_Value *root_value = NULL;
+    JSON_Parser *parser = NULL;
+    test_suite_2(parse_in_chunks(file_contents, 1));
+    test_suite_2(parse_in_chunks(file_contents, 7));
+    root_value = parse_in_chunks(file_contents, strlen(file_contents));
+    TEST(json_value_equals(root_value, expected));
+    json_value_free(root_value);
+    json_value_free(expected);
+    free(file_contents);
+
+    file_contents = read_file("tests/test_1_1.txt");
+    TEST(json_value_equals(parse_in_chunks(file_contents, 3), json_parse_string(file_contents)));
+    free(file_contents);
+    file_contents = read_file("tests/test_1_2.txt");
+    TEST(json_value_equals(parse_in_chunks(file_contents, 5), json_parse_string(file_contents)));
+    free(file_contents);
+
+    TEST(json_number(parse_in_chunks("12345", 2)) == 12345);
+    TEST(json_value_get_type(parse_in_chunks(" null ", 1)) == JSONNull);
+    TEST(STREQ(json_string(parse_in_chunks("\"a\\\\\\\"b\"", 1)), "a\\\"b"));
+    TEST(json_value_equals(parse_in_chunks("[1, {\"a\": []}] trailing", 2), json_parse_string("[1,{\"a\":[]}]")));
+    TEST(parse_in_chunks("", 1) == NULL);
+    TEST(parse_in_chunks("[1,]", 1) == NULL);
+    TEST(parse_in_chunks("[1 2]", 1) == NULL);
+    TEST(parse_in_chunks("{\"a\" 1}", 1) == NULL);
+    TEST(parse_in_chunks("{\"a\":1,\"a\":2}", 1) == NULL);
+    TEST(parse_in_chunks("[1}", 1) == NULL);
+    TEST(parse_in_chunks("[tru", 1) == NULL);
+    TEST(parse_in_chunks("[1.]", 1) == NULL);
+    TEST(parse_in_chunks("\"abc", 1) == NULL);
+    TEST(parse_in_chunks("[\"\\u00\"]", 1) == NULL);
+
+    parser = json_parser_init();
+    TEST(json_parser_feed(parser, "[1,", 3) == JSONSuccess);
+    TEST(json_parser_feed(parser, "]", 1) == JSONFailure);
+    TEST(json_parser_feed(parser, "2]", 2) == JSONFailure);
+    TEST(json_parser_finish(parser) == NULL);
+    TEST(json_parser_finish(NULL) == NULL);
+}
+
+typedef struct {
+    int objects, arrays, keys, strings, numbers, booleans, nulls, depth;
+    double sum;
+    char last_string[64];
+} sax_counts;
+
+static JSON_Status count_start_object(void *context) { ((sax_counts*)context)->objects++; ((sax_counts*)context)->depth++; return JSONSuccess; }
+static JSON_Status count_end_object(void *context) { ((sax_counts*)context)->depth--; return JSONSuccess; }
+static JSON_Status count_start_array(void *context) { ((sax_counts*)context)->arrays++; ((sax_counts*)context)->depth++; return JSONSuccess; }
+static JSON_Status count_end_array(void *context) { ((sax_counts*)context)->depth--; return JSONSuccess; }
+static JSON_Status count_key(void *context, const char *key, size_t len) { (void)key; (void)len; ((sax_counts*)context)->keys++; return JSONSuccess; }
+static JSON_Status count_string(void *context, const char *string, size_t len) {
+    sax_counts *counts = (sax_counts*)context;
+    counts->strings++;
+    if (len < sizeof(counts->last_string)) {
+        memcpy(counts->last_string, string, len);
+        counts->last_string[len] = '\0';
+    }
+    return JSONSuccess;
+}
+static JSON_Status count_number(void *context, double number) { ((sax_counts*)context)->numbers++; ((sax_counts*)context)->sum += number; return JSONSuccess; }
+static JSON_Status count_boolean(void *context, int boolean) { (void)boolean; ((sax_counts*)context)->booleans++; return JSONSuccess; }
+static JSON_Status count_null(void *context) { ((sax_counts*)context)->nulls++; return JSONSuccess; }
+static JSON_Status stop_at_null(void *context) { (void)context; return JSONFailure; }
+
+void test_suite_17(void) {
+    JSON_Sax_Callbacks callbacks = { count_start_object, count_end_object, count_start_array, count_end_array,
+                                     count_key, count_string, count_number, count_boolean, count_null };
+    JSON_Sax_Callbacks numbers_only = { NULL, NULL, NULL, NULL, NULL, NULL, count_number, NULL, NULL };
+    sax_counts counts;
+    char *file_contents = read_file("tests/test_2.txt");
+
+    memset(&counts, 0, sizeof(counts));
+    TEST(json_parse_string_sax(file_contents, &callbacks, &counts) == JSONSuccess);
+    TEST(counts.depth == 0);
+    TEST(counts.objects == 4 && counts.arrays == 4);
+    TEST(counts.nulls == 4 && counts.booleans == 4);
+    free(file_contents);
+
+    memset(&counts, 0, sizeof(counts));
+    TEST(json_parse_string_sax(" {\"a\": [1, 2.5, -3, true, null], \"b\": {\"c\": \"x\\ty\"}} ", &callbacks, &counts) == JSONSuccess);
+    TEST(counts.objects == 2 && counts.arrays == 1 && counts.keys == 3);
+    TEST(counts.numbers == 3 && counts.sum == 0.5);
+    TEST(counts.booleans == 1 && counts.nulls == 1 && counts.strings == 1);
+    TEST(STREQ(counts.last_string, "x\ty"));
+
+    memset(&counts, 0, sizeof(counts));
+    TEST(json_parse_string_sax("[\"abc\", {\"d\": [10, 20]}]", &numbers_only, &counts) == JSONSuccess);
+    TEST(counts.numbers == 2 && counts.sum == 30);
+
+    memset(&counts, 0, sizeof(counts));
+    TEST(json_parse_string_sax("[1,]", &callbacks, &counts) == JSONFailure);
+    TEST(json_parse_string_sax("{\"a\" 1}", &callbacks, &counts) == JSONFailure);
+    TEST(json_parse_string_sax("[\"\\x\"]", &callbacks, &counts) == JSONFailure);
+    TEST(json_parse_string_sax("[nul]", &callbacks, &counts) == JSONFailure);
+    TEST(json_parse_string_sax(NULL, &callbacks, &counts) == JSONFailure);
+    callbacks.null = stop_at_null;
+    TEST(json_parse_string_sax("[1, null, 2]", &callbacks, &counts) == JSONFailure);
+}
+
+void test_suite_18(void) {
+    char *file_contents = read_file("tests/test_2.txt");
+    JSON_Value *root_value = json_parse_string(file_contents);
+    JSON_Document *document = json_document_parse(file_contents);
+    JSON_Value *value = NULL;
+    TEST(document != NULL);
+    TEST(json_document_get_type(document) == JSONObject);
+    TEST(STREQ(json_document_dotget_string(document, "string"), "lorem ipsum"));
+    TEST(STREQ(json_document_dotget_string(document, "utf string"), json_object_get_string(json_object(root_value), "utf string")));
+    TEST(json_document_dotget_number(document, "positive one") == 1.0);
+    TEST(json_document_dotget_boolean(document, "boolean false") == 0);
+    TEST(json_document_dotget_boolean(document, "object.nested true") == 1);
+    TEST(STREQ(json_document_dotget_string(document, "object.nested object.lorem"), "ipsum"));
+    value = json_document_get_value(document, "x^2 array");
+    TEST(json_value_equals(value, json_object_get_value(json_object(root_value), "x^2 array")));
+    TEST(json_document_get_value(document, "x^2 array") == value); /* decoded only once */
+    TEST(json_value_equals(json_document_get_value(document, "object"), json_object_get_value(json_object(root_value), "object")));
+    TEST(json_document_get_value(document, "not existing") == NULL);
+    TEST(json_document_dotget_value(document, "string.lorem") == NULL);
+    json_document_free(document);
+    json_value_free(root_value);
+    free(file_contents);
+
+    document = json_document_parse("{\"a\\u0062\": {\"c\": [1, 2]}, \"d\": 1-2, \"e\": \"\\x\"}");
+    TEST(document != NULL);
+    TEST(json_array_get_count(json_value_get_array(json_document_dotget_value(document, "ab.c"))) == 2);
+    TEST(json_document_get_value(document, "d") == NULL); /* values are validated when decoded */
+    TEST(json_document_get_value(document, "e") == NULL);
+    json_document_free(document);
+
+    document = json_document_parse("[1, 2]");
+    TEST(json_document_get_type(document) == JSONArray);
+    TEST(json_document_get_value(document, "a") == NULL);
+    json_document_free(document);
+
+    TEST(json_document_parse("{\"a\": [1, 2}") == NULL);
+    TEST(json_document_parse("{\"a\" 1}") == NULL);
+    TEST(json_document_parse("[1,]") == NULL);
+    TEST(json_document_parse(NULL) == NULL);
+}
+
+void test_suite_19(void) {
+    const char unterminated[] = { '[', '1', ',', '2', ']' };
+    char *file_contents = read_file("tests/test_2.txt");
+    test_suite_2(json_parse_buffer(file_contents, strlen(file_contents)));
+    free(file_contents);
+    file_contents = read_file("tests/test_2_comments.txt");
+    test_suite_2(json_parse_buffer_with_comments(file_contents, strlen(file_contents)));
+    TEST(json_parse_buffer(file_contents, strlen(file_contents)) == NULL);
+    free(file_contents);
+
+    TEST(json_array_get_count(json_value_get_array(json_parse_buffer(unterminated, sizeof(unterminated)))) == 2);
+    TEST(json_parse_buffer(unterminated, sizeof(unterminated) - 1) == NULL);
+    TEST(json_number(json_parse_buffer("123456", 3)) == 123);
+    TEST(json_parse_buffer("[\"abc\"]", 5) == NULL);
+    TEST(json_parse_buffer("", 0) == NULL);
+    TEST(json_parse_buffer(NULL, 0) == NULL);
+    /* trailing input is ignored after the first value, like in json_parse_string */
+    TEST(json_boolean(json_parse_buffer("trueu", 5)) == 1);
+    TEST(json_number(json_parse_buffer("1.5.3", 5)) == 1.5);
+    TEST(json_number(json_parse_buffer("-86-8", 5)) == -86);
+    TEST(json_array_get_count(json_array(json_parse_buffer("[1]x", 4))) == 1);
+    TEST(json_parse_buffer("[trueu]", 7) == NULL);
+    TEST(json_parse_buffer("04", 2) == NULL);
+    TEST(json_value_equals(json_parse_buffer_with_comments("/* a */ [1, // b\n 2 /**/] // c", 30), json_parse_string("[1,2]")));
+    TEST(json_parse_buffer_with_comments("[1, /* 2]", 9) == NULL);
+    TEST(json_parse_buffer_with_comments("[1 / 2]", 7) == NULL);
+}
+
+void test_suite_20(void) {
+    JSON_Sax_Callbacks callbacks = { count_start_object, count_end_object, count_start_array, count_end_array,
+                                     count_key, count_string, count_number, count_boolean, count_null };
+    sax_counts counts;
+    char *file_contents = read_file("tests/test_1_2.txt");
+    JSON_Value *root_value = NULL;
+    JSON_Document *document = NULL;
+
+    json_set_max_nesting(2);
+    TEST((root_value = json_parse_string("[[1], {\"a\": []}]")) != NULL);
+    json_value_free(root_value);
+    TEST((root_value = parse_in_chunks("[[1], {\"a\": []}]", 1)) != NULL);
+    json_value_free(root_value);
+    TEST(json_parse_string("[[[1]]]") == NULL);
+    TEST(json_parse_string("{\"a\": {\"b\": [1]}}") == NULL);
+    TEST(parse_in_chunks("[[[1]]]", 1) == NULL);
+    TEST(json_parse_string_sax("[[[1]]]", &callbacks, &counts) == JSONFailure);
+    TEST(json_document_parse("[[[1]]]") == NULL);
+
+    json_set_max_nesting(4096); /* file has over 2048 levels of nesting */
+    TEST((root_value = json_parse_string(file_contents)) != NULL);
+    json_value_free(root_value);
+    TEST((root_value = parse_in_chunks(file_contents, 7)) != NULL);
+    json_value_free(root_value);
+    memset(&counts, 0, sizeof(counts));
+    TEST(json_parse_string_sax(file_contents, &callbacks, &counts) == JSONSuccess);
+    TEST(counts.arrays > 2048 && counts.depth == 0);
+    TEST((document = json_document_parse(file_contents)) != NULL);
+    json_document_free(document);
+
+    json_set_max_nesting(1000);
+    TEST(json_parse_string(file_contents) == NULL);
+    free(file_contents);
+}
+
+void test_suite_21(void) {
+    const char *numbers = "[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19]";
+    const char *mixed = "[1, -2.5, true, null, \"a\", [false], {\"b\": 18446744073709551615}]";
+    JSON_Value *root_value = NULL, *copy = NULL, *item = NULL;
+    JSON_Array *array = NULL;
+    char *serialized = NULL;
+    double numbers_out[25];
+    size_t i = 0;
+
+    root_value = json_parse_string(numbers);
+    array = json_array(root_value);
+    for (i = 0; i < 20; i++) {
+        TEST(json_array_get_number(array, i) == (double)i);
+    }
+    serialized = json_serialize_to_string(root_value);
+    TEST(serialized != NULL && strcmp(serialized, numbers) == 0);
+    json_free_serialized_string(serialized);
+    copy = json_parse_string("[0]");
+    TEST(json_validate(copy, root_value) == JSONSuccess);
+    json_value_free(copy);
+    memset(numbers_out, 0, sizeof(numbers_out));
+    TEST(json_array_get_numbers(array, numbers_out, 25) == 20);
+    TEST(numbers_out[0] == 0 && numbers_out[19] == 19 && numbers_out[20] == 0);
+    TEST(json_array_get_numbers(array, numbers_out, 5) == 5);
+    TEST(json_array_get_numbers(NULL, numbers_out, 5) == 0);
+
+    item = json_array_get_value(array, 7);
+    TEST(json_value_get_number(item) == 7 && json_value_get_parent(item) == root_value);
+    TEST(json_array_get_value(array, 7) == item);
+    TEST(json_array_remove(array, 0) == JSONSuccess);
+    TEST(json_array_get_value(array, 6) == item);
+    TEST(json_array_replace_boolean(array, 6, 1) == JSONSuccess);
+    TEST(json_array_get_boolean(array, 6) == 1);
+    json_value_free(root_value);
+
+    /* arrays of nulls, booleans and numbers are packed until they change */
+    root_value = json_parse_string("[1, 2.5, 18446744073709551615, true, null, 6]");
+    array = json_array(root_value);
+    TEST(json_array_get_numbers(array, numbers_out, 25) == 3);
+    TEST(numbers_out[1] == 2.5 && numbers_out[2] == 18446744073709551615.0);
+    item = json_array_get_value(array, 1);
+    TEST(json_array_replace_number(array, 1, 7) == JSONSuccess);
+    TEST(json_array_get_value(array, 1) == item && json_value_get_number(item) == 7);
+    TEST(json_array_replace_null(array, 2) == JSONSuccess && json_value_get_type(json_array_get_value(array, 2)) == JSONNull);
+    TEST(json_array_replace_string(array, 3, "x") == JSONSuccess);
+    TEST(json_array_get_value(array, 1) == item && strcmp(json_array_get_string(array, 3), "x") == 0);
+    TEST(json_array_append_number(array, 8) == JSONSuccess && json_array_get_number(array, 6) == 8);
+    TEST(json_array_get_numbers(array, numbers_out, 25) == 2);
+    copy = json_value_deep_copy(root_value);
+    TEST(json_value_equals(root_value, copy));
+    json_value_free(copy);
+    TEST(json_array_clear(array) == JSONSuccess && json_array_get_count(array) == 0);
+    json_value_free(root_value);
+    root_value = json_parse_string("[false, 0, -1]");
+    array = json_array(root_value);
+    TEST(json_array_get_numbers(array, numbers_out, 25) == 0);
+    TEST(json_array_append_value(array, json_value_init_string("x")) == JSONSuccess);
+    TEST(json_array_get_boolean(array, 0) == 0 && json_array_get_number(array, 2) == -1);
+    json_value_free(root_value);
+
+    root_value = json_parse_string(mixed);
+    array = json_array(root_value);
+    TEST(json_array_get_number(array, 1) == -2.5);
+    TEST(json_array_get_boolean(array, 2) == 1);
+    TEST(json_value_get_type(json_array_get_value(array, 3)) == JSONNull);
+    TEST(json_value_get_parent(json_array_get_value(array, 3)) == root_value);
+    TEST(json_value_is_integer(json_array_get_value(array, 0)));
+    TEST(json_array_get_string(array, 0) == NULL && json_array_get_number(array, 4) == 0);
+    TEST(json_array_get_uint64(json_array_get_array(array, 5), 0) == 0);
+    TEST(json_object_get_uint64(json_array_get_object(array, 6), "b") == UINT64_MAX);
+    copy = json_value_deep_copy(root_value);
+    TEST(json_value_equals(root_value, copy));
+    TEST(json_array_append_uint64(json_array(copy), UINT64_MAX) == JSONSuccess);
+    TEST(json_array_append_int64(json_array(copy), INT64_MIN) == JSONSuccess);
+    TEST(json_array_append_number(json_array(copy), 1.0 / 0.0) == JSONFailure);
+    TEST(json_array_get_uint64(json_array(copy), 7) == UINT64_MAX);
+    TEST(json_array_get_numbers(json_array(copy), numbers_out, 25) == 2);
+    TEST(numbers_out[0] == 1 && numbers_out[1] == -2.5);
+    TEST(json_value_is_integer(json_array_get_value(json_array(copy), 8)));
+    serialized = json_serialize_to_string(copy);
+    TEST(serialized != NULL && strcmp(serialized, "[1,-2.5,true,null,\"a\",[false],{\"b\":18446744073709551615},18446744073709551615,-9223372036854775808]") == 0);
+    json_free_serialized_string(serialized);
+    json_value_free(copy);
+    json_value_free(root_value);
+
+    /* items of arena documents */
+    root_value = json_parse_string_arena(numbers);
+    item = json_array_get_value(json_array(root_value), 19);
+    TEST(json_value_get_number(item) == 19 && json_value_get_parent(item) == root_value);
+    TEST(json_array_append_value(json_array(root_value), json_value_init_string("x")) == JSONSuccess);
+    TEST(strcmp(json_array_get_string(json_array(root_value), 20), "x") == 0);
+    json_value_free(root_value);
+
+    /* items of documents parsed with the push parser */
+    root_value = json_parse_buffer(mixed, strlen(mixed));
+    array = json_array(root_value);
+    item = json_array_get_value(array, 1);
+    TEST(json_value_get_number(item) == -2.5 && json_value_get_parent(item) == root_value);
+    TEST(json_value_is_integer(json_array_get_value(array, 0)));
+    TEST(json_array_get_boolean(json_array_get_array(array, 5), 0) == 0);
+    TEST(json_array_replace_value(array, 1, json_value_init_string("x")) == JSONSuccess);
+    TEST(json_array_remove(array, 0) == JSONSuccess);
+    TEST(strcmp(json_array_get_string(array, 0), "x") == 0 && json_array_get_boolean(array, 1) == 1);
+    TEST(json_array_clear(array) == JSONSuccess && json_array_get_count(array) == 0);
+    TEST(json_array_append_null(array) == JSONSuccess && json_array_get_count(array) == 1);
+    json_value_free(root_value);
+}
+
+void test_suite_22(void) {
+    JSON_Value *a = json_parse_file("tests/test_2.txt");
+    JSON_Value *b = json_parse_string("[1,2]");
+    char *buf = NULL;
+    size_t buf_size = 0;
+    char small_buf[4];
+    TEST(json_serialize_to_reusable_buffer(a, &buf, &buf_size) == JSONSuccess);
+    TEST(STREQ(buf, json_serialize_to_string(a)));
+    TEST(buf_size >= json_serialization_size(a));
+    TEST(json_serialize_to_reusable_buffer(b, &buf, &buf_size) == JSONSuccess);
+    TEST(STREQ(buf, "[1,2]"));
+    TEST(json_serialize_to_reusable_buffer_pretty(a, &buf, &buf_size) == JSONSuccess);
+    TEST(STREQ(buf, json_serialize_to_string_pretty(a)));
+    TEST(json_serialize_to_buffer(b, small_buf, sizeof(small_buf)) == JSONFailure);
+    TEST(small_buf[0] == '\0');
+    json_free_serialized_string(buf);
+    json_value_free(a);
+    json_value_free(b);
+}
+
+void test_suite_23(void) {
+    JSON_Value *a = json_parse_file("tests/test_2.txt");
+    JSON_Value *b = json_value_init_array();
+    char *expected = NULL, *long_string = (char*)malloc(10001), *streamed = NULL;
+    FILE *fp = NULL;
+    size_t len = 0;
+    memset(long_string, 'x', 10000);
+    long_string[10000] = '\0';
+    json_array_append_string(json_value_get_array(b), long_string);
+    json_array_append_value(json_value_get_array(b), json_value_deep_copy(a));
+    expected = json_serialize_to_string_pretty(b);
+    streamed = (char*)calloc(strlen(expected) + 1, 1);
+    TEST(json_serialize_to_callback_pretty(b, append_to_string, streamed) == JSONSuccess);
+    TEST(STREQ(expected, streamed));
+    TEST(json_serialize_to_callback(b, fail_writing, NULL) == JSONFailure);
+    TEST(json_serialize_to_callback(NULL, append_to_string, streamed) == JSONFailure);
+
+    fp = tmpfile();
+    TEST(json_serialize_to_fd(b, fileno(fp)) == JSONSuccess);
+    len = (size_t)ftell(fp);
+    rewind(fp);
+    expected = json_serialize_to_string(b);
+    memset(streamed, 0, strlen(expected) + 1);
+    TEST(len == strlen(expected) && fread(streamed, 1, len, fp) == len && STREQ(expected, streamed));
+    fclose(fp);
+    fp = tmpfile();
+    TEST(json_serialize_to_fp(b, fp) == JSONSuccess);
+    TEST((size_t)ftell(fp) == len);
+    fclose(fp);
+
+    TEST(STREQ(serialize_in_chunks(b, 0, 1), json_serialize_to_string(b)));
+    TEST(STREQ(serialize_in_chunks(b, 1, 7), json_serialize_to_string_pretty(b)));
+    TEST(STREQ(serialize_in_chunks(b, 1, 5000), json_serialize_to_string_pretty(b)));
+    TEST(STREQ(serialize_in_chunks(json_parse_string("[[],{},[[1]],{\"a\":{}},\"\"]"), 1, 3), "[\n    [],\n    {},\n    [\n        [\n            1\n        ]\n    ],\n    {\n        \"a\": {}\n    },\n    \"\"\n]"));
+    TEST(STREQ(serialize_in_chunks(json_value_init_string("lorem"), 0, 2), "\"lorem\""));
+    TEST(json_serializer_init(NULL) == NULL);
+    json_value_free(a);
+    json_value_free(b);
 }
 
 void print_commits_info(const char *username, const char *repo) {